@@ -0,0 +1,192 @@
+/*
+ * algorithm: counting sort (cisla jsou bajty, jen 256 moznych hodnot)
+ *
+ * vstup i vystup stejne jako odd-even.cpp, ale bez porovnavani:
+ * -kazdy proc si ze souboru numbers nacte jen svuj blok
+ * -z bloku spocita histogram 256 hodnot, jeden MPI_Allreduce z nich udela
+ *  histogram celeho vstupu
+ * -kazdy proc zna z histogramu, ktere hodnoty patri na pozice jeho bloku
+ *  ve vysledku, a rovnou je vyplni
+ * master pak vysledky posbira (Gatherv) jako ostatni algoritmy; razeni je
+ * omezene jen propustnosti pameti, slouzi jako zakladni mereni pro ostatni
+ * (velikosti a posuny bloku pro MPI_Gatherv jsou int, vstup smi mit nejvyse
+ * INT_MAX cisel)
+ *
+ * vystup jde pres spolecny buffer z common/output_sink.h: s prepinacem -n se
+ * nevypisuje vstup, s -o soubor se serazena cisla zapisou binarne (jako bajty,
+ * stejne jako soubor numbers) misto textoveho vypisu
+ *
+ * preklad s -DMEASURE_TIME vypise dobu jednotlivych fazi (maximum pres procesory)
+ */
+
+#include <mpi.h>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <unistd.h>
+
+#include "../../common/output_sink.h"
+
+using namespace std;
+
+#define VALUES 256              //pocet moznych hodnot bajtu
+
+#ifdef MEASURE_TIME
+//faze, kterym se meri cas
+enum {
+    T_READ,
+    T_HISTOGRAM,
+    T_FILL,
+    T_GATHER,
+    T_OUTPUT,
+    T_COUNT
+};
+static const char *time_names[T_COUNT]= { "read", "histogram", "fill", "gather", "output" };
+//pricte cas od posledni znacky k dane fazi
+#define TIME_MARK(phase) do { double now= MPI_Wtime(); times[phase]+= now - lasttime; lasttime= now; } while(false)
+#else
+#define TIME_MARK(phase) do { ; } while(false)
+#endif
+
+int main(int argc, char *argv[])
+{
+    int numprocs;               //pocet procesoru
+    int myid;                   //muj rank
+    long long numcount= 0;      //pocet vsech cisel
+    vector<int> counts;         //velikosti bloku vsech procesoru
+    vector<int> displs;         //zacatky bloku vsech procesoru
+    vector<unsigned char> mybytes;  //muj blok vstupu
+    vector<unsigned char> sorted;   //muj blok vysledku
+
+    //MPI INIT
+    MPI_Init(&argc,&argv);                          // inicializace MPI
+    MPI_Comm_size(MPI_COMM_WORLD, &numprocs);       // zjistíme, kolik procesů běží
+    MPI_Comm_rank(MPI_COMM_WORLD, &myid);           // zjistíme id svého procesu
+
+    //PREPINACE
+    int opt;
+    bool echo= true;            //vypis vstupu
+    const char *outname= NULL;  //soubor pro binarni vystup
+    while((opt= getopt(argc, argv, "no:")) != -1){
+	if(opt == 'n' && !(echo= false)) continue;
+	if(opt == 'o' && (outname= optarg)) continue;
+	if(myid == 0) cerr<<"pouziti: "<<argv[0]<<" [-n] [-o binarni_vystup]"<<endl;
+	MPI_Finalize();
+	return EXIT_FAILURE;
+    }//while
+
+#ifdef MEASURE_TIME
+    double times[T_COUNT]= { 0 };
+    double lasttime;
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    lasttime= MPI_Wtime();
+#endif
+
+    //NACTENI SOUBORU
+    //kazdy proc zjisti velikost souboru a nacte jen svuj blok,
+    //prvnich numcount%numprocs procesoru dostane o jedno cislo navic
+    char input_name[]= "numbers";                     //jmeno souboru
+    ifstream fin(input_name, ios::in | ios::binary);  //cteni ze souboru
+
+    fin.seekg(0, ios::end);
+    numcount= fin.good() ? static_cast<long long>(fin.tellg()) : 0;
+    if(numcount > numeric_limits<int>::max()){
+	if(myid == 0) cerr<<"prilis mnoho cisel v souboru "<<input_name<<endl;
+	MPI_Finalize();
+	return EXIT_FAILURE;
+    }
+    counts.resize(numprocs);
+    displs.resize(numprocs);
+    for(int i=0, displ=0; i<numprocs; i++){
+	counts[i]= numcount/numprocs + (i < numcount%numprocs);
+	displs[i]= displ;
+	displ+= counts[i];
+    }//for
+
+    mybytes.resize(counts[myid]);
+    fin.seekg(displs[myid], ios::beg);
+    if(!fin.read(reinterpret_cast<char *>(mybytes.data()), mybytes.size())){
+	cerr<<"nelze nacist soubor "<<input_name<<endl;
+	MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    fin.close();
+    TIME_MARK(T_READ);
+
+    //HISTOGRAM-----------------------------------------------------------------
+    long long myhist[VALUES]= { 0 }, hist[VALUES];
+    for(size_t i=0; i<mybytes.size(); i++){
+	myhist[mybytes[i]]++;
+    }//for
+    MPI_Allreduce(myhist, hist, VALUES, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+    TIME_MARK(T_HISTOGRAM);
+    //HISTOGRAM-----------------------------------------------------------------
+
+
+    //VYPLNENI MEHO USEKU VYSLEDKU
+    //hodnota v zabira ve vysledku pozice [zacatek v, zacatek v + hist[v]),
+    //z nich vyplnim prunik s mym blokem [from, to)
+    long long from= displs[myid], to= from + counts[myid];
+    sorted.resize(counts[myid]);
+    for(long long v=0, start=0; v<VALUES && start<to; start+= hist[v], v++){
+	long long first= max(start, from), last= min(start + hist[v], to);
+	if(first < last){
+	    fill(sorted.begin() + (first - from), sorted.begin() + (last - from), static_cast<unsigned char>(v));
+	}
+    }//for
+    TIME_MARK(T_FILL);
+
+
+    //FINALNI DISTRIBUCE VYSLEDKU K MASTEROVI-----------------------------------
+    vector<unsigned char> final(myid == 0 ? numcount : 0);
+    MPI_Gatherv(sorted.data(), counts[myid], MPI_UNSIGNED_CHAR,
+	    final.data(), counts.data(), displs.data(), MPI_UNSIGNED_CHAR, 0, MPI_COMM_WORLD);
+    TIME_MARK(T_GATHER);
+
+    //vypis vstupu az s vysledky, master na nej posbira bloky vsech procesoru
+    vector<unsigned char> input(myid == 0 && echo ? numcount : 0);
+    if(echo){
+	MPI_Gatherv(mybytes.data(), counts[myid], MPI_UNSIGNED_CHAR,
+		input.data(), counts.data(), displs.data(), MPI_UNSIGNED_CHAR, 0, MPI_COMM_WORLD);
+    }
+    if(myid == 0) try {
+	OutputSink out(outname ? OutputSink::BINARY : OutputSink::TEXT, outname ? outname : "");
+
+	for(int i=0, invar=0; echo && i<numcount; i++){
+	    while(i >= displs[invar] + counts[invar]) invar++;
+	    out<<invar<<':'<<static_cast<int>(input[i])<<'\n';   //kdo dostane kere cislo
+	}//for
+
+	for(int i=0, invar=0; out.get_mode() == OutputSink::TEXT && i<numcount; i++){
+	    while(i >= displs[invar] + counts[invar]) invar++;
+	    out<<"proc: "<<invar<<" num: "<<static_cast<int>(final[i])<<'\n';
+	}//for
+
+	//binarne stejne jako vstup, jedno cislo na bajt (final uz bajty jsou)
+	if(out.get_mode() == OutputSink::BINARY) out.write_raw(final.data(), final.size());
+	out.flush();
+    } catch(const exception &e){
+	cerr<<e.what()<<endl;
+	MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }//if vypis
+    TIME_MARK(T_OUTPUT);
+    //VYSLEDKY------------------------------------------------------------------
+
+#ifdef MEASURE_TIME
+    //vypis doby jednotlivych fazi, za kazdou fazi nejpomalejsi proc
+    double maxtimes[T_COUNT];
+    MPI_Reduce(times, maxtimes, T_COUNT, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    if(myid == 0){
+	for(int i=0; i<T_COUNT; i++){
+	    cout<<"time "<<time_names[i]<<": "<<fixed<<maxtimes[i]<<endl;
+	}//for
+    }
+#endif
+
+    MPI_Finalize();
+    return 0;
+
+}//main
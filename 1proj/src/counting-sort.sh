@@ -0,0 +1,28 @@
+#!/bin/bash
+
+#pocet cisel bud zadam nebo 10 :)
+if [ $# -lt 1 ];then
+    numbers=10;
+else
+    numbers=$1;
+fi;
+
+#pocet procesoru bud zadam nebo 4
+if [ $# -lt 2 ];then
+    procs=4;
+else
+    procs=$2;
+fi;
+
+#preklad cpp zdrojaku
+mpic++ --prefix /usr/local/share/OpenMPI -O2 -o countsort counting-sort.cpp
+
+
+#vyrobeni souboru s random cisly
+dd if=/dev/random bs=1 count=$numbers of=numbers
+
+#spusteni (dalsi parametry dostane program, napr. -n nebo -o vystup)
+mpirun --prefix /usr/local/share/OpenMPI -np $procs countsort "${@:3}"
+
+#uklid
+rm -f countsort numbers
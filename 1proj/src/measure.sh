@@ -0,0 +1,70 @@
+#!/bin/bash
+
+#porovnani skalovani sample sortu, odd-even transposition sortu a jeho
+#vlaknove verze (stejny pocet vlaken jako procesoru); counting sort bez
+#porovnavani je zakladni mereni, pod ktere se razeni bajtu nedostane
+#pouziti: ./measure.sh [pocet_cisel] [pocty procesoru...]
+#vystup: out.txt se sloupci procs, oets, ss, threads, cs (prumerny cas razeni bez vypisu)
+
+OUTFILE=out.txt
+RUNS=5
+MPIRUN="mpirun --prefix /usr/local/share/OpenMPI"
+
+if [ $# -lt 1 ];then
+    numbers=1000000;
+else
+    numbers=$1;
+    shift;
+fi;
+if [ $# -lt 1 ];then
+    set -- 1 2 4 8 16
+fi;
+
+#preklad s merenim casu jednotlivych fazi
+mpic++ --prefix /usr/local/share/OpenMPI -O2 -march=native -DMEASURE_TIME -o oets odd-even.cpp
+mpic++ --prefix /usr/local/share/OpenMPI -O2 -DMEASURE_TIME -o samplesort sample-sort.cpp
+g++ -pthread -O2 -march=native -DMEASURE_TIME -o oets-threads odd-even-threads.cpp
+mpic++ --prefix /usr/local/share/OpenMPI -O2 -DMEASURE_TIME -o countsort counting-sort.cpp
+
+#vyrobeni souboru s random cisly
+dd if=/dev/urandom bs=1 count=$numbers of=numbers 2> /dev/null
+
+#soucet casu vsech fazi krome vypisu (parametrem je cely prikaz)
+sort_time()
+{
+    $1 | grep '^time ' | grep -v '^time output:' | cut -d: -f2 | paste -sd+ | bc -l
+}
+
+echo "procs oets ss threads cs" > "${OUTFILE}"
+for PROCS in "$@"
+do
+    printf "${PROCS}: "
+    OETS=0.0
+    SS=0.0
+    THREADS=0.0
+    CS=0.0
+
+    for RUN in `seq 1 ${RUNS}`
+    do
+	printf "${RUN}, "
+	OETS=`echo "${OETS} + \`sort_time "$MPIRUN -np ${PROCS} ./oets"\`" | bc -l`
+	SS=`echo "${SS} + \`sort_time "$MPIRUN -np ${PROCS} ./samplesort"\`" | bc -l`
+	THREADS=`echo "${THREADS} + \`sort_time "./oets-threads -t ${PROCS}"\`" | bc -l`
+	CS=`echo "${CS} + \`sort_time "$MPIRUN -np ${PROCS} ./countsort"\`" | bc -l`
+    done
+    printf "\n"
+
+    AVG_OETS=`echo "${OETS} / ${RUNS}" | bc -l`
+    AVG_SS=`echo "${SS} / ${RUNS}" | bc -l`
+    AVG_THREADS=`echo "${THREADS} / ${RUNS}" | bc -l`
+    AVG_CS=`echo "${CS} / ${RUNS}" | bc -l`
+
+    echo "${PROCS} ${AVG_OETS} ${AVG_SS} ${AVG_THREADS} ${AVG_CS}" >> "${OUTFILE}"
+    echo "oets: avg = ${AVG_OETS}"
+    echo "ss:   avg = ${AVG_SS}"
+    echo "threads: avg = ${AVG_THREADS}"
+    echo "cs:   avg = ${AVG_CS}"
+done
+
+#uklid
+rm -f oets samplesort oets-threads countsort numbers
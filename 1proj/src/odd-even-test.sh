@@ -0,0 +1,67 @@
+#!/bin/bash
+
+#test spravnosti oets a oets-threads pro pocty cisel nedelitelne poctem procesoru, na nahodnem
+#a sestupne serazenem vstupu (nejvic fazi transpozic)
+#pouziti: ./odd-even-test.sh
+#vypise kazdy beh, jehoz vystup neni serazeny vstup, a vrati pocet chyb
+
+MPIRUN="mpirun --prefix /usr/local/share/OpenMPI"
+export LC_ALL=C
+fails=0
+
+#preklad cpp zdrojaku
+mpic++ --prefix /usr/local/share/OpenMPI -O2 -march=native -o oets odd-even.cpp
+g++ -pthread -O2 -march=native -o oets-threads odd-even-threads.cpp
+
+#bajty souboru jako cisla, jedno na radek
+bytes()
+{
+    od -An -tu1 -v "$1" | tr -s ' ' '\n' | grep -v '^$'
+}
+
+#spusti program (parametrem je cely prikaz) a porovna binarni vystup se
+#serazenym souborem numbers
+check()
+{
+    rm -f out
+    $@ -n -o out > /dev/null
+    if ! cmp -s <(bytes numbers | sort -n) <(bytes out); then
+	echo "chyba: $@ (`stat -c %s numbers` cisel)"
+	fails=$((fails+1))
+    fi
+}
+
+#vsechny varianty razeni pro soubor numbers na danem poctu procesoru (vlaken)
+check_all()
+{
+    check $MPIRUN -np $1 oets
+    check $MPIRUN -np $1 oets -c 1
+    if [ $(($1 & ($1-1))) -eq 0 ];then
+	check $MPIRUN -np $1 oets -b
+    fi;
+    check ./oets-threads -t $1
+}
+
+#129 155 114 25 66 na 4 procesorech
+printf '\201\233\162\031\102' > numbers
+check_all 4
+
+#dvojice pocet_cisel:pocet_procesoru
+for CASE in 5:4 10:3 7:8 401:4 1000:7 5003:5
+do
+    numbers=${CASE%:*}
+    procs=${CASE#*:}
+
+    dd if=/dev/urandom bs=1 count=$numbers of=numbers 2> /dev/null
+    check_all $procs
+
+    #sestupne serazeny vstup
+    bytes numbers | sort -rn | awk '{ printf "%c", $1 }' > reversed
+    mv reversed numbers
+    check_all $procs
+done
+
+#uklid
+rm -f oets oets-threads numbers out
+
+exit $fails
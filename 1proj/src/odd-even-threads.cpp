@@ -0,0 +1,260 @@
+/*
+ * algorithm: odd-even transposition sort, vlakna misto MPI procesu
+ *
+ * stejny vstup i vystup jako odd-even.cpp, jen misto procesoru jsou vlakna:
+ * -kazde vlakno vlastni jeden blok a jeden pomocny blok stejne velikosti,
+ *  oba alokuje jednou na zacatku; blok si na zacatku seradi
+ * -bloky jsou stejne velke, posledni se doplni nejvetsim cislem (jako
+ *  v odd-even.cpp, jinak by numthreads fazi nestacilo)
+ * -v kazde fazi obe vlakna dvojice spocitaji corank (block_corank), tedy
+ *  kolik cisel z ktereho bloku patri nizsimu, a kazde slije jen svou
+ *  polovinu ze sousednich bloku do sveho pomocneho bloku (block_merge)
+ * -mezi fazemi je bariera, za ni se pomocny blok stane aktualnim (vymeni se
+ *  ukazatele), zadna cisla se nekopiruji ani nealokuji
+ *
+ * vystup jde pres spolecny buffer z common/output_sink.h: s prepinacem -n se
+ * nevypisuje vstup, s -o soubor se serazena cisla zapisou binarne (jako bajty,
+ * stejne jako soubor numbers) misto textoveho vypisu
+ *
+ * pouziti: oets-threads [-t pocet_vlaken] [-n] [-o binarni_vystup]
+ * (implicitne jedno vlakno na kazde jadro)
+ * preklad s -DMEASURE_TIME vypise dobu jednotlivych fazi
+ */
+
+#include <pthread.h>
+#include <unistd.h>
+#include <time.h>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+
+#include "simd-sort.h"
+#include "../../common/output_sink.h"
+
+using namespace std;
+
+#ifdef MEASURE_TIME
+//faze, kterym se meri cas
+enum {
+    T_READ,
+    T_LOCAL_SORT,
+    T_SORT,
+    T_OUTPUT,
+    T_COUNT
+};
+static const char *time_names[T_COUNT]= { "read", "local sort", "sort", "output" };
+//pricte cas od posledni znacky k dane fazi
+#define TIME_MARK(phase) do { double now= wtime(); times[phase]+= now - lasttime; lasttime= now; } while(false)
+#else
+#define TIME_MARK(phase) do { ; } while(false)
+#endif
+
+//data sdilena vsemi vlakny
+struct shared_t {
+    const unsigned char *input; //vsechny nactene bajty
+    vector<int *> blocks[2];    //blocks[faze%2][i]: aktualni blok vlakna i na zacatku faze
+    vector<int> counts;         //pocty skutecnych cisel v blocich vsech vlaken
+    vector<int> displs;         //zacatky bloku vsech vlaken ve vstupu
+    int blocksize;              //velikost vsech bloku vcetne doplnenych cisel
+    int numthreads;             //pocet vlaken
+    int numphases;              //pocet fazi merge-split
+    pthread_barrier_t barrier;  //bariera mezi fazemi
+#ifdef MEASURE_TIME
+    double times[T_COUNT];
+    double lasttime;
+#endif
+};
+
+//parametry jednoho vlakna
+struct thread_t {
+    pthread_t thread;
+    int myid;                   //cislo vlakna
+    shared_t *sh;
+    vector<int> bufs[2];        //aktualni a pomocny blok
+};
+
+/*
+ * aktualni cas v sekundach
+ */
+double wtime(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+/*
+ * telo vlakna: lokalni serazeni bloku a numphases fazi merge-split
+ */
+void *sort_thread(void *arg)
+{
+    thread_t *t= static_cast<thread_t *>(arg);
+    shared_t *sh= t->sh;
+    int myid= t->myid;
+    int cur= 0;                 //ktery z bufs je aktualni blok
+
+    //LOKALNI SERAZENI BLOKU
+    const unsigned char *myinput= sh->input + sh->displs[myid];
+    t->bufs[0].assign(sh->blocksize, numeric_limits<int>::max());
+    t->bufs[1].resize(sh->blocksize);
+    copy(myinput, myinput + sh->counts[myid], t->bufs[0].begin());
+    block_sort(t->bufs[0].data(), t->bufs[0].data() + sh->blocksize);
+    sh->blocks[0][myid]= t->bufs[0].data();
+    pthread_barrier_wait(&sh->barrier);
+#ifdef MEASURE_TIME
+    double *times= sh->times;
+    double &lasttime= sh->lasttime;
+    if(myid == 0) TIME_MARK(T_LOCAL_SORT);
+#endif
+
+    //RAZENI--------------------------------------------------------------------
+    for(int phase=0; phase<sh->numphases; phase++){
+	int *const *now= sh->blocks[phase%2].data();
+	int **next= sh->blocks[(phase+1)%2].data();
+
+	//v sude fazi paruji (0,1),(2,3),..., v liche (1,2),(3,4),...
+	int neighid= ((myid%2) == (phase%2)) ? myid+1 : myid-1;
+	next[myid]= now[myid];
+	if(neighid >= 0 && neighid < sh->numthreads){
+	    int low= min(myid, neighid), high= max(myid, neighid);
+	    const int *a= now[low], *b= now[high];
+	    size_t n= sh->blocksize;
+
+	    if(n && a[n-1] > b[0]){//jinak uz jsou v poradi
+		//z n nejmensich cisel je mine z nizsiho bloku, zbytek z vyssiho;
+		//nizsi si necha prave tech n, vyssi vsechno za nimi
+		size_t mine= block_corank<int>(n, a, n, b, n);
+		int *merged= t->bufs[!cur].data();
+
+		if(myid == low) block_merge<int>(a, a + mine, b, b + (n - mine), merged);
+		else block_merge<int>(a + mine, a + n, b + (n - mine), b + n, merged);
+		cur= !cur;
+		next[myid]= merged;
+	    }
+	}
+	//soused uz cte jen novy ukazatel, muj stary blok je volny
+	pthread_barrier_wait(&sh->barrier);
+    }//for pro linearitu
+    //RAZENI--------------------------------------------------------------------
+
+    return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+    shared_t sh;
+    int numcount;               //pocet vsech cisel
+    vector<unsigned char> input;//vsechny nactene bajty
+
+    //PREPINACE
+    int opt;
+    bool echo= true;            //vypis vstupu
+    const char *outname= NULL;  //soubor pro binarni vystup
+    sh.numthreads= sysconf(_SC_NPROCESSORS_ONLN);
+    while((opt= getopt(argc, argv, "t:no:")) != -1){
+	if(opt == 't' && (sh.numthreads= atoi(optarg)) > 0) continue;
+	if(opt == 'n' && !(echo= false)) continue;
+	if(opt == 'o' && (outname= optarg)) continue;
+	cerr<<"pouziti: "<<argv[0]<<" [-t pocet_vlaken] [-n] [-o binarni_vystup]"<<endl;
+	return EXIT_FAILURE;
+    }//while
+
+#ifdef MEASURE_TIME
+    double *times= sh.times;
+    double &lasttime= sh.lasttime;
+    fill(times, times + T_COUNT, 0.0);
+    lasttime= wtime();
+#endif
+
+    //NACTENI SOUBORU
+    char input_name[]= "numbers";                     //jmeno souboru
+    ifstream fin(input_name, ios::in | ios::binary);  //cteni ze souboru
+
+    fin.seekg(0, ios::end);
+    input.resize(fin.good() ? static_cast<size_t>(fin.tellg()) : 0);
+    fin.seekg(0, ios::beg);
+    if(!fin.read(reinterpret_cast<char *>(input.data()), input.size())){
+	cerr<<"nelze nacist soubor "<<input_name<<endl;
+	return EXIT_FAILURE;
+    }
+    fin.close();
+    numcount= input.size();
+    sh.input= input.data();
+
+    //VELIKOSTI BLOKU
+    //vsechny bloky maji blocksize cisel, chybejici se doplni nejvetsim cislem;
+    //pro numthreads stejne velkych bloku staci numthreads fazi (i pro lichy
+    //pocet vlaken)
+    sh.blocksize= (numcount + sh.numthreads - 1)/sh.numthreads;
+    sh.numphases= sh.numthreads;
+    sh.counts.resize(sh.numthreads);
+    sh.displs.resize(sh.numthreads);
+    sh.blocks[0].resize(sh.numthreads);
+    sh.blocks[1].resize(sh.numthreads);
+    for(int i=0; i<sh.numthreads; i++){
+	sh.counts[i]= max(0, min(sh.blocksize, numcount - i*sh.blocksize));
+	sh.displs[i]= min(numcount, i*sh.blocksize);
+    }//for
+    TIME_MARK(T_READ);
+
+    //SPUSTENI VLAKEN
+    vector<thread_t> threads(sh.numthreads);
+    pthread_barrier_init(&sh.barrier, NULL, sh.numthreads);
+    for(int i=0; i<sh.numthreads; i++){
+	threads[i].myid= i;
+	threads[i].sh= &sh;
+	if(pthread_create(&threads[i].thread, NULL, sort_thread, &threads[i])){
+	    cerr<<"nelze vytvorit vlakno "<<i<<endl;
+	    return EXIT_FAILURE;
+	}
+    }//for
+    for(int i=0; i<sh.numthreads; i++){
+	pthread_join(threads[i].thread, NULL);
+    }//for
+    pthread_barrier_destroy(&sh.barrier);
+    TIME_MARK(T_SORT);
+
+
+    //VYSLEDKY------------------------------------------------------------------
+    try {
+	OutputSink out(outname ? OutputSink::BINARY : OutputSink::TEXT, outname ? outname : "");
+
+	for(int i=0, invar=0; echo && i<numcount; i++){
+	    while(i >= sh.displs[invar] + sh.counts[invar]) invar++;
+	    out<<invar<<':'<<static_cast<int>(input[i])<<'\n';   //kdo dostane kere cislo
+	}//for
+
+	//po posledni fazi jsou aktualni bloky v blocks[numphases%2], doplnena
+	//nejvetsi cisla jsou na konci a nevypisuji se
+	int *const *blocks= sh.blocks[sh.numphases%2].data();
+	for(int i=0, invar=0; out.get_mode() == OutputSink::TEXT && i<numcount; i++){
+	    while(i >= sh.displs[invar] + sh.counts[invar]) invar++;
+	    out<<"proc: "<<invar<<" num: "<<blocks[invar][i - sh.displs[invar]]<<'\n';
+	}//for
+
+	//binarne stejne jako vstup, jedno cislo na bajt (vstup uz neni potreba)
+	for(int i=0; out.get_mode() == OutputSink::BINARY && i<sh.numthreads; i++){
+	    copy(blocks[i], blocks[i] + sh.counts[i], input.begin() + sh.displs[i]);
+	}//for
+	if(out.get_mode() == OutputSink::BINARY) out.write_raw(input.data(), input.size());
+	out.flush();
+    } catch(const exception &e){
+	cerr<<e.what()<<endl;
+	return EXIT_FAILURE;
+    }
+    TIME_MARK(T_OUTPUT);
+    //VYSLEDKY------------------------------------------------------------------
+
+#ifdef MEASURE_TIME
+    for(int i=0; i<T_COUNT; i++){
+	cout<<"time "<<time_names[i]<<": "<<fixed<<times[i]<<endl;
+    }//for
+#endif
+
+    return 0;
+
+}//main
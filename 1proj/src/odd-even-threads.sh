@@ -0,0 +1,28 @@
+#!/bin/bash
+
+#pocet cisel bud zadam nebo 10 :)
+if [ $# -lt 1 ];then
+    numbers=10;
+else
+    numbers=$1;
+fi;
+
+#pocet vlaken bud zadam nebo jedno na kazde jadro
+if [ $# -lt 2 ];then
+    threads=`nproc`;
+else
+    threads=$2;
+fi;
+
+#preklad cpp zdrojaku
+g++ -pthread -O2 -march=native -o oets-threads odd-even-threads.cpp
+
+
+#vyrobeni souboru s random cisly
+dd if=/dev/random bs=1 count=$numbers of=numbers
+
+#spusteni (dalsi parametry dostane program, napr. -n nebo -o vystup)
+./oets-threads -t $threads "${@:3}"
+
+#uklid
+rm -f oets-threads numbers
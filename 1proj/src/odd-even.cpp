@@ -2,134 +2,311 @@
  * algorithm: odd-even transposition sort (alg. ~40 lines long)
  * author: jakub zak
  *
+ * kazdy proc drzi souvisly blok cisel, ktery si na zacatku lokalne seradi, a
+ * v lichych/sudych fazich provadi se sousedem merge-split celych bloku (pro
+ * numcount == numprocs jde o puvodni algoritmus); bloky jsou stejne velke,
+ * posledni se doplni nejvetsim cislem, jinak by numprocs fazi nestacilo
+ *
+ * s prepinacem -b se misto transpozic pouzije bitonicke razeni (jen pro pocet
+ * procesoru 2^d): d(d+1)/2 kroku merge-split s procesorem, jehoz rank se lisi
+ * v jednom bitu
+ *
+ * s prepinacem -c N se kazdych N fazi procesory (jednim MPI_Allreduce) dohodnou,
+ * jestli v posledni liche a sude fazi nekdo prohazoval; pokud ne, je serazeno
+ * a razeni skonci driv (vypise se pocet provedenych fazi)
+ *
+ * lokalni razeni a slevani pri merge-split obstaraji vektorova jadra ze
+ * simd-sort.h (vybrana podle num_t, s -mavx2/-march=native)
+ *
+ * vystup jde pres spolecny buffer z common/output_sink.h: s prepinacem -n se
+ * nevypisuje vstup, s -o soubor se serazena cisla zapisou binarne (jako bajty,
+ * stejne jako soubor numbers) misto textoveho vypisu
+ *
+ * preklad s -DMEASURE_TIME vypise dobu jednotlivych fazi (maximum pres procesory)
  */
 
 #include <mpi.h>
 #include <iostream>
 #include <fstream>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <unistd.h>
+
+#include "simd-sort.h"
+#include "../../common/output_sink.h"
 
 using namespace std;
 
 #define TAG 0
 
+typedef int num_t;              //typ razenych cisel
+#define MPI_NUM_T MPI_INT
+#define SPLIT_LIMIT 1024        //bloky do teto velikosti se vymeni cele jednou zpravou
+
+#ifdef MEASURE_TIME
+//faze, kterym se meri cas
+enum {
+    T_READ,
+    T_SCATTER,
+    T_LOCAL_SORT,
+    T_SORT,
+    T_GATHER,
+    T_OUTPUT,
+    T_COUNT
+};
+static const char *time_names[T_COUNT]= { "read", "scatter", "local sort", "sort", "gather", "output" };
+//pricte cas od posledni znacky k dane fazi
+#define TIME_MARK(phase) do { double now= MPI_Wtime(); times[phase]+= now - lasttime; lasttime= now; } while(false)
+#else
+#define TIME_MARK(phase) do { ; } while(false)
+#endif
+
+/*
+ * merge-split s jednim sousedem
+ * -oba procesory si vymeni data najednou (MPI_Sendrecv), jeden (lower) si necha
+ *  nejmensi a druhy nejvetsi cisla z obou bloku
+ * -u velkych bloku si nejdriv vymeni jen krajni cisla a pak poslou jen ta
+ *  cisla, ktera muzou prejit k sousedovi (zbytek bloku se nezmeni)
+ * -kazdy si necha tolik cisel, kolik mel
+ * -vraci true, pokud se neco prohodilo
+ */
+bool compare_split(vector<num_t> &mynumbers, vector<num_t> &neighnumbers, vector<num_t> &merged,
+	bool lower, int neighid, int neighsize)
+{
+    MPI_Status stat;
+    int blocksize= mynumbers.size();
+    num_t *sendbuf= mynumbers.data();
+    int sendcount= blocksize;
+    int recvcount;
+
+    if(!blocksize || !neighsize) return false;      //prazdny blok, neni co prohazovat
+
+    if(max(blocksize, neighsize) > SPLIT_LIMIT){
+	num_t mybound= lower ? mynumbers.back() : mynumbers.front();
+	num_t neighbound;
+
+	MPI_Sendrecv(&mybound, 1, MPI_NUM_T, neighid, TAG, &neighbound, 1, MPI_NUM_T, neighid, TAG, MPI_COMM_WORLD, &stat);
+	if(lower ? mybound <= neighbound : neighbound <= mybound) return false; //bloky uz jsou v poradi
+
+	if(lower){//poslu cisla vetsi nez sousedovo nejmensi
+	    sendbuf= &*upper_bound(mynumbers.begin(), mynumbers.end(), neighbound);
+	    sendcount= mynumbers.data() + blocksize - sendbuf;
+	}
+	else{//poslu cisla mensi nez sousedovo nejvetsi
+	    sendcount= lower_bound(mynumbers.begin(), mynumbers.end(), neighbound) - mynumbers.begin();
+	}
+    }
+
+    MPI_Sendrecv(sendbuf, sendcount, MPI_NUM_T, neighid, TAG,
+	    neighnumbers.data(), neighsize, MPI_NUM_T, neighid, TAG, MPI_COMM_WORLD, &stat);
+    MPI_Get_count(&stat, MPI_NUM_T, &recvcount);
+    if(!recvcount) return false;
+
+    if(lower ? neighnumbers[0] >= mynumbers[blocksize-1] : neighnumbers[recvcount-1] <= mynumbers[0]){
+	return false;                               //bloky uz jsou v poradi
+    }
+
+    //z k nejmensich cisel obou bloku je mine mych, zbytek sousedovych;
+    //nizsi si necha prave tech k, vyssi vsechno za nimi
+    size_t k= lower ? blocksize : recvcount;
+    size_t mine= block_corank<num_t>(k, mynumbers.data(), blocksize, neighnumbers.data(), recvcount);
+    size_t neighs= k - mine;
+
+    if(lower){
+	block_merge<num_t>(mynumbers.data(), mynumbers.data() + mine,
+		neighnumbers.data(), neighnumbers.data() + neighs, merged.data());
+    }
+    else{
+	block_merge<num_t>(mynumbers.data() + mine, mynumbers.data() + blocksize,
+		neighnumbers.data() + neighs, neighnumbers.data() + recvcount, merged.data());
+    }
+    mynumbers.swap(merged);
+    return true;
+}
+
 int main(int argc, char *argv[])
 {
     int numprocs;               //pocet procesoru
     int myid;                   //muj rank
-    int neighnumber;            //hodnota souseda
-    int mynumber;               //moje hodnota
-    MPI_Status stat;            //struct- obsahuje kod- source, tag, error
+    int checkinterval= 0;       //po kolika fazich testovat serazeni (0 = nikdy)
+    bool bitonic= false;        //bitonicke razeni misto transpozic
+    int numcount= 0;            //pocet vsech cisel
+    vector<int> counts;         //velikosti bloku vsech procesoru
+    vector<int> displs;         //zacatky bloku vsech procesoru
+    vector<num_t> mynumbers;    //moje hodnoty
+    vector<num_t> neighnumbers; //hodnoty souseda
+    vector<num_t> merged;       //novy blok po merge-split
+    vector<unsigned char> input;//vsechny nactene bajty (jen master)
 
     //MPI INIT
-    MPI_Init(&argc,&argv);                          // inicializace MPI 
-    MPI_Comm_size(MPI_COMM_WORLD, &numprocs);       // zjistíme, kolik procesů běží 
-    MPI_Comm_rank(MPI_COMM_WORLD, &myid);           // zjistíme id svého procesu 
+    MPI_Init(&argc,&argv);                          // inicializace MPI
+    MPI_Comm_size(MPI_COMM_WORLD, &numprocs);       // zjistíme, kolik procesů běží
+    MPI_Comm_rank(MPI_COMM_WORLD, &myid);           // zjistíme id svého procesu
+
+    //PREPINACE
+    int opt;
+    bool echo= true;            //vypis vstupu
+    const char *outname= NULL;  //soubor pro binarni vystup
+    while((opt= getopt(argc, argv, "bc:no:")) != -1){
+	if(opt == 'b' && (bitonic= true)) continue;
+	if(opt == 'c' && (checkinterval= atoi(optarg)) > 0) continue;
+	if(opt == 'n' && !(echo= false)) continue;
+	if(opt == 'o' && (outname= optarg)) continue;
+	if(myid == 0) cerr<<"pouziti: "<<argv[0]<<" [-b] [-c interval_testu_serazeni] [-n] [-o binarni_vystup]"<<endl;
+	MPI_Finalize();
+	return EXIT_FAILURE;
+    }//while
+    if(bitonic && (numprocs & (numprocs-1))){
+	if(myid == 0) cerr<<"bitonicke razeni potrebuje 2^d procesoru, ne "<<numprocs<<endl;
+	MPI_Finalize();
+	return EXIT_FAILURE;
+    }
+
+#ifdef MEASURE_TIME
+    double times[T_COUNT]= { 0 };
+    double lasttime;
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    lasttime= MPI_Wtime();
+#endif
 
     //NACTENI SOUBORU
-    /* -proc s rankem 0 nacita vsechny hodnoty
-     * -postupne rozesle jednotlive hodnoty vsem i sobe
-     */
+    //proc s rankem 0 nacte cely soubor najednou
     if(myid == 0){
-	char input[]= "numbers";                          //jmeno souboru    
-	int number;                                     //hodnota pri nacitani souboru
-	int invar= 0;                                   //invariant- urcuje cislo proc, kteremu se bude posilat
-	fstream fin;                                    //cteni ze souboru
-	fin.open(input, ios::in);                   
-
-	while(fin.good()){
-	    number= fin.get();
-	    if(!fin.good()) break;                      //nacte i eof, takze vyskocim
-	    cout<<invar<<":"<<number<<endl;             //kdo dostane kere cislo
-	    MPI_Send(&number, 1, MPI_INT, invar, TAG, MPI_COMM_WORLD); //buffer,velikost,typ,rank prijemce,tag,komunikacni skupina
-	    invar++;
-	}//while
-	fin.close();                                
+	char input_name[]= "numbers";                     //jmeno souboru
+	ifstream fin(input_name, ios::in | ios::binary);  //cteni ze souboru
+
+	fin.seekg(0, ios::end);
+	input.resize(fin.good() ? static_cast<size_t>(fin.tellg()) : 0);
+	fin.seekg(0, ios::beg);
+	if(!fin.read(reinterpret_cast<char *>(input.data()), input.size())){
+	    cerr<<"nelze nacist soubor "<<input_name<<endl;
+	    MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+	}
+	fin.close();
+	numcount= input.size();
     }//nacteni souboru
+    TIME_MARK(T_READ);
+
+    //VELIKOSTI BLOKU
+    //vsechny bloky maji blocksize cisel, chybejici se doplni nejvetsim cislem;
+    //counts a displs popisuji jen skutecna cisla (posledni procesory jich muzou
+    //mit min nebo zadne)
+    MPI_Bcast(&numcount, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    int blocksize= (numcount + numprocs - 1)/numprocs;
+    counts.resize(numprocs);
+    displs.resize(numprocs);
+    for(int i=0; i<numprocs; i++){
+	counts[i]= max(0, min(blocksize, numcount - i*blocksize));
+	displs[i]= min(numcount, i*blocksize);
+    }//for
+    mynumbers.resize(blocksize, numeric_limits<num_t>::max());
+    neighnumbers.resize(blocksize);
+    merged.resize(blocksize);
+
+    //ROZESLANI BLOKU
+    //jedna kolektivni operace misto zpravy pro kazde cislo
+    vector<unsigned char> mybytes(counts[myid]);
+    MPI_Scatterv(input.data(), counts.data(), displs.data(), MPI_UNSIGNED_CHAR,
+	    mybytes.data(), counts[myid], MPI_UNSIGNED_CHAR, 0, MPI_COMM_WORLD);
+    copy(mybytes.begin(), mybytes.end(), mynumbers.begin());
+    TIME_MARK(T_SCATTER);
+
+    //LOKALNI SERAZENI BLOKU
+    block_sort(mynumbers.data(), mynumbers.data() + mynumbers.size());
+    TIME_MARK(T_LOCAL_SORT);
 
-    //PRIJETI HODNOTY CISLA
-    //vsechny procesory(vcetne mastera) prijmou hodnotu a zahlasi ji
-    MPI_Recv(&mynumber, 1, MPI_INT, 0, TAG, MPI_COMM_WORLD, &stat); //buffer,velikost,typ,rank odesilatele,tag, skupina, stat
-    //cout<<"i am:"<<myid<<" my number is:"<<mynumber<<endl;
-
-    //LIMIT PRO INDEXY
-    int oddlimit= 2*(numprocs/2)-1;                 //limity pro sude
-    int evenlimit= 2*((numprocs-1)/2);              //liche
-    int halfcycles= numprocs/2;
-    int cycles=0;                                   //pocet cyklu pro pocitani slozitosti
-    //if(myid == 0) cout<<oddlimit<<":"<<evenlimit<<endl;
-
-
-    //RAZENI------------chtelo by to umet pocitat cykly nebo neco na testy------
-    //cyklus pro linearitu
-    for(int j=1; j<=halfcycles; j++){
-	cycles++;           //pocitame cykly, abysme mohli udelat krasnej graf:)
-
-	//sude proc 
-	if((!(myid%2) || myid==0) && (myid<oddlimit)){
-	    MPI_Send(&mynumber, 1, MPI_INT, myid+1, TAG, MPI_COMM_WORLD);          //poslu sousedovi svoje cislo
-	    MPI_Recv(&mynumber, 1, MPI_INT, myid+1, TAG, MPI_COMM_WORLD, &stat);   //a cekam na nizsi
-	    //cout<<"ss: "<<myid<<endl;
-	}//if sude
-	else if(myid<=oddlimit){//liche prijimaji zpravu a vraceji mensi hodnotu (to je ten swap)
-	    MPI_Recv(&neighnumber, 1, MPI_INT, myid-1, TAG, MPI_COMM_WORLD, &stat); //jsem sudy a prijimam
-
-	    if(neighnumber > mynumber){                                             //pokud je leveho sous cislo vetsi
-		MPI_Send(&mynumber, 1, MPI_INT, myid-1, TAG, MPI_COMM_WORLD);       //poslu svoje 
-		mynumber= neighnumber;                                              //a vemu si jeho
-	    }
-	    else MPI_Send(&neighnumber, 1, MPI_INT, myid-1, TAG, MPI_COMM_WORLD);   //pokud je mensi nebo stejne vratim
-	    //cout<<"sl: "<<myid<<endl;
-	}//else if (liche)
-	else{//sem muze vlezt jen proc, co je na konci
-	}//else
-
-	//liche proc 
-	if((myid%2) && (myid<evenlimit)){
-	    MPI_Send(&mynumber, 1, MPI_INT, myid+1, TAG, MPI_COMM_WORLD);           //poslu sousedovi svoje cislo
-	    MPI_Recv(&mynumber, 1, MPI_INT, myid+1, TAG, MPI_COMM_WORLD, &stat);    //a cekam na nizsi
-	    //cout<<"ll: "<<myid<<endl;
-	}//if liche
-	else if(myid<=evenlimit && myid!=0){//sude prijimaji zpravu a vraceji mensi hodnotu (to je ten swap)
-	    MPI_Recv(&neighnumber, 1, MPI_INT, myid-1, TAG, MPI_COMM_WORLD, &stat); //jsem sudy a prijimam
-
-	    if(neighnumber > mynumber){                                             //pokud je leveho sous cislo vetsi
-		MPI_Send(&mynumber, 1, MPI_INT, myid-1, TAG, MPI_COMM_WORLD);       //poslu svoje 
-		mynumber= neighnumber;                                              //a vemu si jeho
-	    }
-	    else MPI_Send(&neighnumber, 1, MPI_INT, myid-1, TAG, MPI_COMM_WORLD);   //pokud je mensi nebo stejne vratim
-	    //cout<<"ls: "<<myid<<endl;
-	}//else if (sude)
-	else{//sem muze vlezt jen proc, co je na konci
-	}//else
+    int cycles=0;                                   //pocet fazi pro pocitani slozitosti
+    bool swapped[2]= { true, true };                //prohazovalo se v posledni sude/liche fazi?
+
+
+    //RAZENI--------------------------------------------------------------------
+    if(bitonic){
+	//v kroku bit spolupracuje proc s tim, jehoz rank se lisi v tomto bitu
+	//smer razeni urcuje bit nad stage (v poslednim stage vsichni vzestupne)
+	for(int stage=1; stage<numprocs; stage<<=1){
+	    for(int bit=stage; bit>0; bit>>=1){
+		cycles++;
+
+		int neighid= myid ^ bit;
+		bool ascending= !(myid & (stage<<1));
+		compare_split(mynumbers, neighnumbers, merged, (myid < neighid) == ascending, neighid, blocksize);
+	    }//for
+	}//for
+    }
+    //pro numprocs stejne velkych bloku staci numprocs fazi (i pro lichy pocet
+    //procesoru), merge-split bloku se chova jako porovnani a prohozeni cisel
+    else for(int phase=0; phase<numprocs; phase++){
+	cycles++;           //pocitame faze, abysme mohli udelat krasnej graf:)
 
+	//v sude fazi paruji (0,1),(2,3),..., v liche (1,2),(3,4),...
+	int neighid= ((myid%2) == (phase%2)) ? myid+1 : myid-1;
+	if(neighid >= 0 && neighid < numprocs){//jinak sem muze vlezt jen proc, co je na konci
+	    swapped[phase%2]= compare_split(mynumbers, neighnumbers, merged, myid < neighid, neighid, blocksize);
+	}
+	else swapped[phase%2]= false;
+
+	//TEST SERAZENI
+	//kdyz se neprohazovalo ani v sude ani v liche fazi, jsou vsechny sousedni bloky serazene
+	if(checkinterval && phase > 0 && !(cycles % checkinterval)){
+	    int localswap= swapped[0] || swapped[1];
+	    int globalswap;
+	    MPI_Allreduce(&localswap, &globalswap, 1, MPI_INT, MPI_LOR, MPI_COMM_WORLD);
+	    if(!globalswap) break;
+	}
     }//for pro linearitu
+    TIME_MARK(T_SORT);
     //RAZENI--------------------------------------------------------------------
 
 
     //FINALNI DISTRIBUCE VYSLEDKU K MASTEROVI-----------------------------------
-    int* final= new int [numprocs];
-    //final=(int*) malloc(numprocs*sizeof(int));
-    for(int i=1; i<numprocs; i++){
-	if(myid == i) MPI_Send(&mynumber, 1, MPI_INT, 0, TAG,  MPI_COMM_WORLD);
-	if(myid == 0){
-	    MPI_Recv(&neighnumber, 1, MPI_INT, i, TAG, MPI_COMM_WORLD, &stat); //jsem 0 a prijimam
-	    final[i]=neighnumber;
-	}//if sem master
-    }//for
+    //doplnena nejvetsi cisla jsou po serazeni na konci, neposilaji se
+    vector<num_t> final(myid == 0 ? numcount : 0);
+    MPI_Gatherv(mynumbers.data(), counts[myid], MPI_NUM_T,
+	    final.data(), counts.data(), displs.data(), MPI_NUM_T, 0, MPI_COMM_WORLD);
+    TIME_MARK(T_GATHER);
 
-    if(myid == 0){
-	//cout<<cycles<<endl;
-	final[0]= mynumber;
-	for(int i=0; i<numprocs; i++){
-	    cout<<"proc: "<<i<<" num: "<<final[i]<<endl;
+    if(myid == 0) try {
+	OutputSink out(outname ? OutputSink::BINARY : OutputSink::TEXT, outname ? outname : "");
+
+	//vypis vstupu az s vysledky, at na nej ostatni procesory necekaji
+	for(int i=0, invar=0; echo && i<numcount; i++){
+	    while(i >= displs[invar] + counts[invar]) invar++;
+	    out<<invar<<':'<<static_cast<int>(input[i])<<'\n';   //kdo dostane kere cislo
+	}//for
+
+	if(checkinterval && !bitonic) out<<"phases: "<<cycles<<'/'<<numprocs<<'\n';
+	for(int i=0, invar=0; out.get_mode() == OutputSink::TEXT && i<numcount; i++){
+	    while(i >= displs[invar] + counts[invar]) invar++;
+	    out<<"proc: "<<invar<<" num: "<<static_cast<long long>(final[i])<<'\n';
 	}//for
+
+	//binarne stejne jako vstup, jedno cislo na bajt
+	vector<unsigned char> bytes(out.get_mode() == OutputSink::BINARY ? numcount : 0);
+	copy(final.begin(), final.begin() + bytes.size(), bytes.begin());
+	out.write_raw(bytes.data(), bytes.size());
+	out.flush();
+    } catch(const exception &e){
+	cerr<<e.what()<<endl;
+	MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
     }//if vypis
-    //cout<<"i am:"<<myid<<" my number is:"<<mynumber<<endl;
+    TIME_MARK(T_OUTPUT);
     //VYSLEDKY------------------------------------------------------------------
 
+#ifdef MEASURE_TIME
+    //vypis doby jednotlivych fazi, za kazdou fazi nejpomalejsi proc
+    double maxtimes[T_COUNT];
+    MPI_Reduce(times, maxtimes, T_COUNT, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    if(myid == 0){
+	for(int i=0; i<T_COUNT; i++){
+	    cout<<"time "<<time_names[i]<<": "<<fixed<<maxtimes[i]<<endl;
+	}//for
+    }
+#endif
 
-    MPI_Finalize(); 
+    MPI_Finalize();
     return 0;
 
 }//main
-
@@ -1,22 +1,29 @@
 #!/bin/bash
 
 #pocet cisel bud zadam nebo 10 :)
-if [ $# -lt 1 ];then 
+if [ $# -lt 1 ];then
     numbers=10;
 else
     numbers=$1;
 fi;
 
+#pocet procesoru bud zadam nebo jeden na kazde cislo
+#(kazdy proc drzi stejne velky blok cisel, posledni se doplni nejvetsim cislem)
+if [ $# -lt 2 ];then
+    procs=$numbers;
+else
+    procs=$2;
+fi;
+
 #preklad cpp zdrojaku
-mpic++ --prefix /usr/local/share/OpenMPI -o oets odd-even.cpp
+mpic++ --prefix /usr/local/share/OpenMPI -O2 -march=native -o oets odd-even.cpp
 
 
 #vyrobeni souboru s random cisly
 dd if=/dev/random bs=1 count=$numbers of=numbers
 
-#spusteni
-mpirun --prefix /usr/local/share/OpenMPI -np $numbers oets
+#spusteni (dalsi parametry dostane program, napr. -b nebo -c 2)
+mpirun --prefix /usr/local/share/OpenMPI -np $procs oets "${@:3}"
 
 #uklid
 rm -f oets numbers
-
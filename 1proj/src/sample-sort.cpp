@@ -0,0 +1,270 @@
+/*
+ * algorithm: sample sort (parallel sorting by regular sampling)
+ *
+ * vstup i vystup stejne jako odd-even.cpp:
+ * -proc s rankem 0 nacte soubor numbers a rozdeli ho na bloky (Scatterv)
+ * -kazdy proc blok lokalne seradi a vybere z nej pravidelne vzorky
+ * -ze vsech vzorku se vyberou deliciho cisla (numprocs-1), podle kterych
+ *  kazdy rozdeli svuj blok na numprocs useku
+ * -jeden MPI_Alltoallv posle kazdy usek svemu procesoru
+ * -kazdy slije prijate serazene useky a master vysledky posbira (Gatherv)
+ * komunikace tedy probiha v konstantnim poctu kroku nezavisle na numprocs
+ *
+ * vystup jde pres spolecny buffer z common/output_sink.h: s prepinacem -n se
+ * nevypisuje vstup, s -o soubor se serazena cisla zapisou binarne (jako bajty,
+ * stejne jako soubor numbers) misto textoveho vypisu
+ *
+ * preklad s -DMEASURE_TIME vypise dobu jednotlivych fazi (maximum pres procesory)
+ */
+
+#include <mpi.h>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <unistd.h>
+
+#include "../../common/output_sink.h"
+
+using namespace std;
+
+#ifdef MEASURE_TIME
+//faze, kterym se meri cas
+enum {
+    T_READ,
+    T_SCATTER,
+    T_LOCAL_SORT,
+    T_SPLITTERS,
+    T_EXCHANGE,
+    T_MERGE,
+    T_GATHER,
+    T_OUTPUT,
+    T_COUNT
+};
+static const char *time_names[T_COUNT]= { "read", "scatter", "local sort", "splitters",
+    "exchange", "merge", "gather", "output" };
+//pricte cas od posledni znacky k dane fazi
+#define TIME_MARK(phase) do { double now= MPI_Wtime(); times[phase]+= now - lasttime; lasttime= now; } while(false)
+#else
+#define TIME_MARK(phase) do { ; } while(false)
+#endif
+
+/*
+ * spocita zacatky bloku z jejich velikosti, vraci celkovy pocet
+ */
+int displacements(const vector<int> &counts, vector<int> &displs)
+{
+    int displ= 0;
+
+    displs.resize(counts.size());
+    for(size_t i=0; i<counts.size(); i++){
+	displs[i]= displ;
+	displ+= counts[i];
+    }//for
+    return displ;
+}
+
+/*
+ * slije serazene useky (zacatky v displs) po dvojicich, dokud nezbyde jeden
+ */
+void merge_runs(vector<int> &numbers, vector<int> displs)
+{
+    displs.push_back(numbers.size());
+    while(displs.size() > 2){
+	vector<int> next;
+	size_t i;
+
+	for(i=0; i+2<displs.size(); i+=2){
+	    inplace_merge(numbers.begin() + displs[i], numbers.begin() + displs[i+1], numbers.begin() + displs[i+2]);
+	    next.push_back(displs[i]);
+	}//for
+	if(i+1 < displs.size()) next.push_back(displs[i]);   //lichy usek zustava
+	next.push_back(numbers.size());
+	displs.swap(next);
+    }//while
+}
+
+int main(int argc, char *argv[])
+{
+    int numprocs;               //pocet procesoru
+    int myid;                   //muj rank
+    int numcount= 0;            //pocet vsech cisel
+    vector<int> counts;         //velikosti bloku vsech procesoru
+    vector<int> displs;         //zacatky bloku vsech procesoru
+    vector<int> mynumbers;      //moje hodnoty
+    vector<unsigned char> input;//vsechny nactene bajty (jen master)
+
+    //MPI INIT
+    MPI_Init(&argc,&argv);                          // inicializace MPI
+    MPI_Comm_size(MPI_COMM_WORLD, &numprocs);       // zjistíme, kolik procesů běží
+    MPI_Comm_rank(MPI_COMM_WORLD, &myid);           // zjistíme id svého procesu
+
+    //PREPINACE
+    int opt;
+    bool echo= true;            //vypis vstupu
+    const char *outname= NULL;  //soubor pro binarni vystup
+    while((opt= getopt(argc, argv, "no:")) != -1){
+	if(opt == 'n' && !(echo= false)) continue;
+	if(opt == 'o' && (outname= optarg)) continue;
+	if(myid == 0) cerr<<"pouziti: "<<argv[0]<<" [-n] [-o binarni_vystup]"<<endl;
+	MPI_Finalize();
+	return EXIT_FAILURE;
+    }//while
+
+#ifdef MEASURE_TIME
+    double times[T_COUNT]= { 0 };
+    double lasttime;
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    lasttime= MPI_Wtime();
+#endif
+
+    //NACTENI SOUBORU
+    //proc s rankem 0 nacte cely soubor najednou
+    if(myid == 0){
+	char input_name[]= "numbers";                     //jmeno souboru
+	ifstream fin(input_name, ios::in | ios::binary);  //cteni ze souboru
+
+	fin.seekg(0, ios::end);
+	input.resize(fin.good() ? static_cast<size_t>(fin.tellg()) : 0);
+	fin.seekg(0, ios::beg);
+	if(!fin.read(reinterpret_cast<char *>(input.data()), input.size())){
+	    cerr<<"nelze nacist soubor "<<input_name<<endl;
+	    MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+	}
+	fin.close();
+	numcount= input.size();
+    }//nacteni souboru
+    TIME_MARK(T_READ);
+
+    //VELIKOSTI BLOKU
+    //prvnich numcount%numprocs procesoru dostane o jedno cislo navic
+    MPI_Bcast(&numcount, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    counts.resize(numprocs);
+    for(int i=0; i<numprocs; i++){
+	counts[i]= numcount/numprocs + (i < numcount%numprocs);
+    }//for
+    displacements(counts, displs);
+    mynumbers.resize(counts[myid]);
+
+    //ROZESLANI BLOKU
+    vector<unsigned char> mybytes(counts[myid]);
+    MPI_Scatterv(input.data(), counts.data(), displs.data(), MPI_UNSIGNED_CHAR,
+	    mybytes.data(), counts[myid], MPI_UNSIGNED_CHAR, 0, MPI_COMM_WORLD);
+    copy(mybytes.begin(), mybytes.end(), mynumbers.begin());
+    TIME_MARK(T_SCATTER);
+
+    //LOKALNI SERAZENI BLOKU
+    sort(mynumbers.begin(), mynumbers.end());
+    TIME_MARK(T_LOCAL_SORT);
+
+    //VYBER DELICICH CISEL------------------------------------------------------
+    /* -kazdy proc vybere az numprocs rovnomerne rozlozenych vzorku svyho bloku
+     * -pocty vzorku zna kazdy z velikosti bloku, staci jeden Allgatherv
+     * -kazdy si vzorky seradi a vezme numprocs-1 rovnomerne rozlozenych
+     */
+    vector<int> samplecounts(numprocs);
+    vector<int> sampledispls;
+    for(int i=0; i<numprocs; i++){
+	samplecounts[i]= min(numprocs, counts[i]);
+    }//for
+    int samplecount= displacements(samplecounts, sampledispls);
+
+    vector<int> mysamples(samplecounts[myid]);
+    for(int i=0; i<samplecounts[myid]; i++){
+	mysamples[i]= mynumbers[(long long)i*counts[myid]/samplecounts[myid]];
+    }//for
+    vector<int> samples(samplecount);
+    MPI_Allgatherv(mysamples.data(), samplecounts[myid], MPI_INT,
+	    samples.data(), samplecounts.data(), sampledispls.data(), MPI_INT, MPI_COMM_WORLD);
+    sort(samples.begin(), samples.end());
+
+    vector<int> splitters(numprocs-1);
+    for(int i=1; i<numprocs && samplecount; i++){
+	splitters[i-1]= samples[(long long)i*samplecount/numprocs];
+    }//for
+    TIME_MARK(T_SPLITTERS);
+    //VYBER DELICICH CISEL------------------------------------------------------
+
+
+    //PREROZDELENI---------------------------------------------------------------
+    //usek i dostane proc i: cisla mezi splitters[i-1] a splitters[i]
+    vector<int> sendcounts(numprocs), senddispls;
+    vector<int> recvcounts(numprocs), recvdispls;
+    vector<int>::iterator from= mynumbers.begin();
+    for(int i=0; i<numprocs; i++){
+	vector<int>::iterator to= (i < numprocs-1) ? upper_bound(from, mynumbers.end(), splitters[i]) : mynumbers.end();
+	sendcounts[i]= to - from;
+	from= to;
+    }//for
+    displacements(sendcounts, senddispls);
+
+    MPI_Alltoall(sendcounts.data(), 1, MPI_INT, recvcounts.data(), 1, MPI_INT, MPI_COMM_WORLD);
+    vector<int> sorted(displacements(recvcounts, recvdispls));
+    MPI_Alltoallv(mynumbers.data(), sendcounts.data(), senddispls.data(), MPI_INT,
+	    sorted.data(), recvcounts.data(), recvdispls.data(), MPI_INT, MPI_COMM_WORLD);
+    TIME_MARK(T_EXCHANGE);
+
+    //LOKALNI SLITI PRIJATYCH USEKU
+    merge_runs(sorted, recvdispls);
+    TIME_MARK(T_MERGE);
+    //PREROZDELENI---------------------------------------------------------------
+
+
+    //FINALNI DISTRIBUCE VYSLEDKU K MASTEROVI-----------------------------------
+    int mycount= sorted.size();
+    MPI_Gather(&mycount, 1, MPI_INT, counts.data(), 1, MPI_INT, 0, MPI_COMM_WORLD);
+    displacements(counts, displs);
+
+    vector<int> final(myid == 0 ? numcount : 0);
+    MPI_Gatherv(sorted.data(), mycount, MPI_INT,
+	    final.data(), counts.data(), displs.data(), MPI_INT, 0, MPI_COMM_WORLD);
+    TIME_MARK(T_GATHER);
+
+    if(myid == 0) try {
+	OutputSink out(outname ? OutputSink::BINARY : OutputSink::TEXT, outname ? outname : "");
+
+	//vypis vstupu az s vysledky, at na nej ostatni procesory necekaji
+	vector<int> incounts(numprocs), indispls;
+	for(int i=0; i<numprocs; i++){
+	    incounts[i]= numcount/numprocs + (i < numcount%numprocs);
+	}//for
+	displacements(incounts, indispls);
+	for(int i=0, invar=0; echo && i<numcount; i++){
+	    while(i >= indispls[invar] + incounts[invar]) invar++;
+	    out<<invar<<':'<<static_cast<int>(input[i])<<'\n';   //kdo dostane kere cislo
+	}//for
+
+	for(int i=0, invar=0; out.get_mode() == OutputSink::TEXT && i<numcount; i++){
+	    while(i >= displs[invar] + counts[invar]) invar++;
+	    out<<"proc: "<<invar<<" num: "<<final[i]<<'\n';
+	}//for
+
+	//binarne stejne jako vstup, jedno cislo na bajt
+	vector<unsigned char> bytes(out.get_mode() == OutputSink::BINARY ? numcount : 0);
+	copy(final.begin(), final.begin() + bytes.size(), bytes.begin());
+	out.write_raw(bytes.data(), bytes.size());
+	out.flush();
+    } catch(const exception &e){
+	cerr<<e.what()<<endl;
+	MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }//if vypis
+    TIME_MARK(T_OUTPUT);
+    //VYSLEDKY------------------------------------------------------------------
+
+#ifdef MEASURE_TIME
+    //vypis doby jednotlivych fazi, za kazdou fazi nejpomalejsi proc
+    double maxtimes[T_COUNT];
+    MPI_Reduce(times, maxtimes, T_COUNT, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    if(myid == 0){
+	for(int i=0; i<T_COUNT; i++){
+	    cout<<"time "<<time_names[i]<<": "<<fixed<<maxtimes[i]<<endl;
+	}//for
+    }
+#endif
+
+    MPI_Finalize();
+    return 0;
+
+}//main
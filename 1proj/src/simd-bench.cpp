@@ -0,0 +1,97 @@
+/*
+ * mereni vektorovych jader ze simd-sort.h proti std::sort/std::merge
+ *
+ * pouziti: simd-bench [pocet_prvku] (implicitne 2^22), viz simd-bench.sh
+ * pro kazdy typ klice vypise cas v sekundach (nejlepsi z RUNS behu); po
+ * kazdem behu porovna vystup jader s vystupem std::sort/std::merge a pri
+ * neshode skonci s chybou
+ */
+
+#include <time.h>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+
+#include "simd-sort.h"
+
+using namespace std;
+
+#define RUNS 5
+
+/*
+ * aktualni cas v sekundach
+ */
+double wtime(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+/*
+ * vraci false, pokud se vystup nektereho jadra lisi od std
+ */
+template <typename T>
+bool bench(const char *name, size_t numcount)
+{
+    vector<T> input(numcount), numbers(numcount), sorted(numcount), merged(numcount), expected(numcount);
+    double sort_std= 1e9, sort_simd= 1e9, merge_std= 1e9, merge_simd= 1e9;
+
+    for(size_t i=0; i<numcount; i++){
+	input[i]= static_cast<T>(rand() ^ (static_cast<long long>(rand()) << 31));
+    }//for
+
+    for(int run=0; run<RUNS; run++){
+	double start;
+
+	sorted= input;
+	start= wtime();
+	sort(sorted.begin(), sorted.end());
+	sort_std= min(sort_std, wtime() - start);
+
+	numbers= input;
+	start= wtime();
+	block_sort(numbers.data(), numbers.data() + numcount);
+	sort_simd= min(sort_simd, wtime() - start);
+	if(numbers != sorted){
+	    cerr<<name<<": block_sort se lisi od std::sort"<<endl;
+	    return false;
+	}
+
+	//slevani dvou serazenych polovin (prokladanych, ne uz serazenych za sebou)
+	numbers= input;
+	sort(numbers.begin(), numbers.begin() + numcount/2);
+	sort(numbers.begin() + numcount/2, numbers.end());
+	const T *first= numbers.data(), *mid= first + numcount/2, *last= first + numcount;
+
+	start= wtime();
+	merge(first, mid, mid, last, expected.data());
+	merge_std= min(merge_std, wtime() - start);
+
+	start= wtime();
+	block_merge(first, mid, mid, last, merged.data());
+	merge_simd= min(merge_simd, wtime() - start);
+	if(merged != expected){
+	    cerr<<name<<": block_merge se lisi od std::merge"<<endl;
+	    return false;
+	}
+    }//for
+
+    cout<<name<<" "<<fixed<<sort_std<<" "<<sort_simd<<" "<<merge_std<<" "<<merge_simd
+	<<(simd_traits<T>::enabled ? "" : " (bez AVX2)")<<endl;
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t numcount= (argc > 1) ? strtoul(argv[1], NULL, 10) : (1 << 22);
+
+    cout<<"key std::sort block_sort std::merge block_merge"<<endl;
+    bool ok= bench<uint8_t>("uint8", numcount);
+    ok= bench<int32_t>("int32", numcount) && ok;
+    ok= bench<int64_t>("int64", numcount) && ok;
+
+    return ok ? 0 : EXIT_FAILURE;
+}
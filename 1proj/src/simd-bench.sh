@@ -0,0 +1,17 @@
+#!/bin/bash
+
+#pocet prvku bud zadam nebo 2^22
+if [ $# -lt 1 ];then
+    numbers=4194304;
+else
+    numbers=$1;
+fi;
+
+#preklad s vektorovymi instrukcemi stroje
+g++ -O2 -march=native -o simd-bench simd-bench.cpp
+
+#spusteni
+./simd-bench $numbers
+
+#uklid
+rm -f simd-bench
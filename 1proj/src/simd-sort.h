@@ -0,0 +1,300 @@
+/*
+ * vektorove razeni a slevani bloku (AVX2) pro odd-even.cpp
+ *
+ * -block_sort: kazdy vektor se seradi bitonickou siti primo v registru,
+ *  vznikle useky delky W se pak slevaji po dvojicich
+ * -block_merge: slevani dvou serazenych useku, vzdy dva vektory najednou
+ *  bitonickou siti (mensi polovina jde na vystup, vetsi zustava v registru)
+ * -block_corank: kolik prvku z kazdeho useku patri mezi k nejmensich,
+ *  merge-split pak slije jen tu cast, kterou si proc necha
+ *
+ * jadro se vybira podle typu klice pri prekladu (simd_traits<T>), vektorove
+ * jsou uint8_t, int32_t a int64_t; ostatni typy a preklad bez -mavx2
+ * pouziji std::sort/std::merge
+ */
+
+#ifndef SIMD_SORT_H
+#define SIMD_SORT_H
+
+#include <algorithm>
+#include <vector>
+#include <cstddef>
+#include <stdint.h>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+//obecny typ: bez vektoroveho jadra
+template <typename T>
+struct simd_traits {
+    static const bool enabled= false;
+};
+
+#ifdef __AVX2__
+/*
+ * spolecne operace nad 256b registrem, potomci doplni sirku, min/max,
+ * prohozeni prvku vzdalenych d (permute) a otoceni poradi (reverse)
+ */
+template <typename T>
+struct avx2_traits {
+    static const bool enabled= true;
+    static const int width= 32/sizeof(T);
+    typedef __m256i vec_t;
+
+    static vec_t load(const T *p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)); }
+    static void store(T *p, vec_t v) { _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), v); }
+    static vec_t blend(vec_t a, vec_t b, vec_t mask) { return _mm256_blendv_epi8(a, b, mask); }
+};
+
+template <>
+struct simd_traits<uint8_t>: avx2_traits<uint8_t> {
+    static vec_t min(vec_t a, vec_t b) { return _mm256_min_epu8(a, b); }
+    static vec_t max(vec_t a, vec_t b) { return _mm256_max_epu8(a, b); }
+    static vec_t permute(vec_t v, int d)
+    {
+	switch(d){
+	    case 16: return _mm256_permute2x128_si256(v, v, 0x01);
+	    case 8: return _mm256_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+	    case 4: return _mm256_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1));
+	    case 2: return _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+	    default: return _mm256_or_si256(_mm256_slli_epi16(v, 8), _mm256_srli_epi16(v, 8));
+	}//switch
+    }
+    static vec_t reverse(vec_t v)
+    {
+	const vec_t idx= _mm256_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+		15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+	return _mm256_permute2x128_si256(_mm256_shuffle_epi8(v, idx), v, 0x01);
+    }
+};
+
+template <>
+struct simd_traits<int32_t>: avx2_traits<int32_t> {
+    static vec_t min(vec_t a, vec_t b) { return _mm256_min_epi32(a, b); }
+    static vec_t max(vec_t a, vec_t b) { return _mm256_max_epi32(a, b); }
+    static vec_t permute(vec_t v, int d)
+    {
+	switch(d){
+	    case 4: return _mm256_permute2x128_si256(v, v, 0x01);
+	    case 2: return _mm256_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+	    default: return _mm256_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1));
+	}//switch
+    }
+    static vec_t reverse(vec_t v) { return _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0)); }
+};
+
+template <>
+struct simd_traits<int64_t>: avx2_traits<int64_t> {
+    //AVX2 nema min/max pro 64b, jen porovnani
+    static vec_t min(vec_t a, vec_t b) { return blend(a, b, _mm256_cmpgt_epi64(a, b)); }
+    static vec_t max(vec_t a, vec_t b) { return blend(b, a, _mm256_cmpgt_epi64(a, b)); }
+    static vec_t permute(vec_t v, int d)
+    {
+	if(d == 2) return _mm256_permute2x128_si256(v, v, 0x01);
+	return _mm256_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+    }
+    static vec_t reverse(vec_t v) { return _mm256_permute4x64_epi64(v, _MM_SHUFFLE(0, 1, 2, 3)); }
+};
+
+/*
+ * bitonicke site nad jednim/dvema registry
+ */
+template <typename T>
+struct simd_network {
+    typedef simd_traits<T> tr;
+    typedef typename tr::vec_t vec_t;
+    static const int width= tr::width;
+
+    //masky prvku, ktere v kroku (k, d) dostanou vetsi cislo: (i&d) xor (i&k),
+    //indexovane log2(k) a log2(d)
+    struct masks_t {
+	vec_t m[8][8];
+
+	masks_t()
+	{
+	    T lanes[width];
+	    for(int k=2; k<=width; k*=2){
+		for(int d=k/2; d>0; d/=2){
+		    for(int i=0; i<width; i++){
+			lanes[i]= (!(i&d) != !(i&k)) ? static_cast<T>(~T(0)) : T(0);
+		    }//for
+		    m[__builtin_ctz(k)][__builtin_ctz(d)]= tr::load(lanes);
+		}//for
+	    }//for
+	}
+    };
+
+    static const vec_t &mask(int k, int d)
+    {
+	static const masks_t masks;
+	return masks.m[__builtin_ctz(k)][__builtin_ctz(d)];
+    }
+
+    //porovnani prvku vzdalenych d, vetsi jde tam, kde je maska
+    static vec_t exchange(vec_t v, int d, const vec_t &maxmask)
+    {
+	vec_t p= tr::permute(v, d);
+	return tr::blend(tr::min(v, p), tr::max(v, p), maxmask);
+    }
+
+    //serazeni jednoho registru
+    static vec_t sort(vec_t v)
+    {
+	for(int k=2; k<=width; k*=2){
+	    for(int d=k/2; d>0; d/=2){
+		v= exchange(v, d, mask(k, d));
+	    }//for
+	}//for
+	return v;
+    }
+
+    //dva serazene registry: lo dostane mensi, hi vetsi polovinu (obe serazene)
+    static void merge(vec_t &lo, vec_t &hi)
+    {
+	vec_t rev= tr::reverse(hi);
+	vec_t a= tr::min(lo, rev);
+	vec_t b= tr::max(lo, rev);
+
+	for(int d=width/2; d>0; d/=2){
+	    a= exchange(a, d, mask(width, d));
+	    b= exchange(b, d, mask(width, d));
+	}//for
+	lo= a;
+	hi= b;
+    }
+};
+#endif //__AVX2__
+
+/*
+ * skalarni slevani tri serazenych useku (dojezd vektoroveho slevani)
+ */
+template <typename T>
+T *merge3(const T *a, const T *ae, const T *b, const T *be, const T *c, const T *ce, T *out)
+{
+    while(a != ae || b != be || c != ce){
+	const T **src= (a != ae) ? &a : ((b != be) ? &b : &c);
+	if(b != be && **src > *b) src= &b;
+	if(c != ce && **src > *c) src= &c;
+	*out++= *(*src)++;
+    }//while
+    return out;
+}
+
+//skalarni jadro
+template <typename T, bool = simd_traits<T>::enabled>
+struct block_kernel {
+    static T *merge(const T *a, const T *ae, const T *b, const T *be, T *out)
+    {
+	return std::merge(a, ae, b, be, out);
+    }
+
+    static void sort(T *first, T *last)
+    {
+	std::sort(first, last);
+    }
+};
+
+#ifdef __AVX2__
+//vektorove jadro
+template <typename T>
+struct block_kernel<T, true> {
+    typedef simd_traits<T> tr;
+    typedef simd_network<T> net;
+    typedef typename tr::vec_t vec_t;
+    static const int width= tr::width;
+
+    static T *merge(const T *a, const T *ae, const T *b, const T *be, T *out)
+    {
+	if(ae - a < width || be - b < width) return std::merge(a, ae, b, be, out);
+
+	vec_t lo= tr::load(a);
+	vec_t hi= tr::load(b);
+	a+= width;
+	b+= width;
+	for(;;){
+	    net::merge(lo, hi);
+	    tr::store(out, lo);
+	    out+= width;
+
+	    //dalsi vektor z useku s mensim prvnim prvkem, jinak by mohl
+	    //prijit mensi prvek az po ulozeni vetsiho
+	    bool take_a= (a != ae) && (b == be || *a <= *b);
+	    const T *&src= take_a ? a : b;
+	    if((take_a ? ae : be) - src < width) break;
+	    lo= tr::load(src);
+	    src+= width;
+	}//for
+
+	T rest[width];
+	tr::store(rest, hi);
+	return merge3(rest, rest + width, a, ae, b, be, out);
+    }
+
+    static void sort(T *first, T *last)
+    {
+	std::ptrdiff_t n= last - first;
+	std::ptrdiff_t full= n - n%width;
+
+	if(n < 2*width){
+	    std::sort(first, last);
+	    return;
+	}
+
+	//useky delky width, posledni kratsi seradi std::sort
+	for(std::ptrdiff_t i=0; i<full; i+=width){
+	    tr::store(first + i, net::sort(tr::load(first + i)));
+	}//for
+	std::sort(first + full, last);
+
+	//slevani useku po dvojicich mezi polem a pomocnym bufferem
+	std::vector<T> buffer(n);
+	T *src= first, *dst= buffer.data();
+	for(std::ptrdiff_t run=width; run<n; run*=2){
+	    for(std::ptrdiff_t i=0; i<n; i+=2*run){
+		std::ptrdiff_t mid= std::min(i + run, n), end= std::min(i + 2*run, n);
+		merge(src + i, src + mid, src + mid, src + end, dst + i);
+	    }//for
+	    std::swap(src, dst);
+	}//for
+	if(src != first) std::copy(src, src + n, first);
+    }
+};
+#endif //__AVX2__
+
+/*
+ * serazeni bloku
+ */
+template <typename T>
+void block_sort(T *first, T *last)
+{
+    block_kernel<T>::sort(first, last);
+}
+
+/*
+ * slevani dvou serazenych useku, vraci konec vystupu
+ */
+template <typename T>
+T *block_merge(const T *a, const T *ae, const T *b, const T *be, T *out)
+{
+    return block_kernel<T>::merge(a, ae, b, be, out);
+}
+
+/*
+ * kolik prvku useku a patri mezi k nejmensich z a a b (z b je to k - vysledek)
+ */
+template <typename T>
+std::size_t block_corank(std::size_t k, const T *a, std::size_t na, const T *b, std::size_t nb)
+{
+    std::size_t lo= (k > nb) ? k - nb : 0;
+    std::size_t hi= std::min(k, na);
+
+    while(lo < hi){
+	std::size_t i= lo + (hi - lo)/2;
+	if(a[i] < b[k-i-1]) lo= i+1;                  //a[i] patri mezi k nejmensich
+	else hi= i;
+    }//while
+    return lo;
+}
+
+#endif //SIMD_SORT_H
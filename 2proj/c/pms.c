@@ -5,19 +5,26 @@
  * Implementation of pipeline merge sort algorithm using MPI.
  */
 
+#define _POSIX_C_SOURCE 200809L /* getopt() with -std=c11 */
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 #include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include <mpi.h>
 
-#include "pms.h"
+#include "queue.h"
 
 #define FILE_NAME "numbers"
 #define TAG 0
 #define ROOT_PROC 0
-#define IN_BUFF_SIZE 8192
+#define DEFAULT_BATCH_SIZE 1024 /* elements per message, -b option */
 
 #ifdef NPRINT_IN
 #define IN_PRINT(...) do { ; } while (0)
@@ -30,63 +37,106 @@
 #define OUT_PRINT(...) do { printf(__VA_ARGS__); } while (0)
 #endif
 
-void receive_and_store(const int proc_rank, queue_t *ques[2], const int seq_size, unsigned *received_cntr)
+void receive_and_store(const int proc_rank, queue_t *ques[2], const unsigned seq_size, unsigned *received_cntr, unsigned char *in_batch, const unsigned batch_size)
 {
     static unsigned store_que_index = 0;
-    unsigned char recv_byte;
+    MPI_Status status;
+    int recv_cnt;
+
+    /* Receive batch of data from superior process. */
+    MPI_Recv(in_batch, batch_size, MPI_CHAR, proc_rank - 1, TAG, MPI_COMM_WORLD, &status);
+    MPI_Get_count(&status, MPI_CHAR, &recv_cnt);
+
+    /* Store numbers up to the end of received sequence at once. */
+    for (unsigned stored = 0; stored < (unsigned)recv_cnt; ) {
+	const unsigned seq_rest = seq_size - *received_cntr % seq_size;
+	const unsigned to_store = (recv_cnt - stored < seq_rest) ? recv_cnt - stored : seq_rest;
 
-    /* Receive and store data from superior process. */
-    MPI_Recv(&recv_byte, 1, MPI_CHAR, proc_rank - 1, TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-    queue_enqueue(ques[store_que_index], recv_byte);
-    (*received_cntr)++;
+	queue_enqueue_bulk(ques[store_que_index], in_batch + stored, to_store);
+	stored += to_store;
+	*received_cntr += to_store;
 
-    /* Received whole sequence? Switch ques. */
-    if (!(*received_cntr % seq_size)) {
-	store_que_index = !store_que_index;
+	/* Received whole sequence? Switch ques. */
+	if (!(*received_cntr % seq_size)) {
+	    store_que_index = !store_que_index;
+	}
     }
 }
 
-void merge_and_send(const int proc_rank, queue_t *ques[2], const int seq_size, const int num_procs)
+void send_batch(const int proc_rank, const int num_procs, const unsigned char *out_batch, const unsigned out_cntr)
 {
-    static unsigned que_popped[2] = { 0 };
-    unsigned char to_send;
-    unsigned send_que_index;
-
-    /* One que allready empty for this sequece? Use element from the second one. */
-    if (que_popped[0] == seq_size) {
-	send_que_index = 1;
-    } else if (que_popped[1] == seq_size) {
-	send_que_index = 0;
-
-    /* Both ques available? Compare front elements. */
-    /* (Possible to switch < to > for reverse order.) */
-    } else if(queue_front(ques[0]) <= queue_front(ques[1])) {
-	send_que_index = 0;
+    /* Last processor doesn't send but prints sorted sequence. */
+    if (proc_rank < num_procs - 1) {
+	MPI_Send(out_batch, out_cntr, MPI_CHAR, proc_rank + 1, TAG, MPI_COMM_WORLD);
     } else {
-	send_que_index = 1;
+	for (unsigned i = 0; i < out_cntr; ++i) {
+	    OUT_PRINT("%hhu\n", out_batch[i]);
+	}
     }
+}
 
-    /* Store and remove element from choosen que. */
-    to_send = queue_dequeue(ques[send_que_index]);
-    que_popped[send_que_index]++;
+void merge_and_send(const int proc_rank, queue_t *ques[2], const unsigned seq_size, const int num_procs, unsigned char *out_batch, unsigned *out_cntr, const unsigned batch_size)
+{
+    static unsigned que_popped[2] = { 0 };
 
-    /* Both ques are fully popped for this sequence? Clear counters. */
-    if (que_popped[0] + que_popped[1] == 2 * seq_size) {
-	que_popped[0] = que_popped[1] = 0;
-    }
+    /* Merge while the smallest element of both sequences is known. */
+    for (;;) {
+	queue_span_t spans[2][2];
+	size_t taken[2] = { 0, 0 };
+	unsigned char *out = out_batch + *out_cntr;
+	const size_t out_free = batch_size - *out_cntr;
 
-    /* Last processor doesn't send but prints sorted sequence. */
-    if (proc_rank < num_procs - 1) {
-	MPI_Send(&to_send, 1, MPI_CHAR, proc_rank + 1, TAG, MPI_COMM_WORLD);
-    } else {
-	OUT_PRINT("%hhu\n", to_send);
+	/* Received elements of both sequences, merge from the first span. */
+	queue_dequeue_spans(ques[0], seq_size - que_popped[0], spans[0]);
+	queue_dequeue_spans(ques[1], seq_size - que_popped[1], spans[1]);
+
+	/* One que allready empty for this sequece? Use elements from the second one. */
+	if (que_popped[0] == seq_size || que_popped[1] == seq_size) {
+	    const unsigned send_que_index = (que_popped[0] == seq_size);
+	    const queue_span_t *span = &spans[send_que_index][0];
+
+	    taken[send_que_index] = (span->size < out_free) ? span->size : out_free;
+	    memcpy(out, span->data, taken[send_que_index]);
+
+	/* Both ques available? Compare front elements. */
+	/* (Possible to switch <= to > for reverse order.) */
+	} else {
+	    const unsigned char *first = spans[0][0].data, *second = spans[1][0].data;
+
+	    for (size_t i = 0; i < out_free && taken[0] < spans[0][0].size && taken[1] < spans[1][0].size; ++i) {
+		out[i] = (first[taken[0]] <= second[taken[1]]) ? first[taken[0]++] : second[taken[1]++];
+	    }
+	}
+
+	/* Element of one sequence not received yet? Wait for it. */
+	if (taken[0] + taken[1] == 0) {
+	    break;
+	}
+
+	/* Remove elements from ques. */
+	queue_dequeue_commit(ques[0], taken[0]);
+	queue_dequeue_commit(ques[1], taken[1]);
+	que_popped[0] += taken[0];
+	que_popped[1] += taken[1];
+	*out_cntr += taken[0] + taken[1];
+
+	/* Both ques are fully popped for this sequence? Clear counters. */
+	if (que_popped[0] + que_popped[1] == 2 * seq_size) {
+	    que_popped[0] = que_popped[1] = 0;
+	}
+
+	/* Batch full? Send it. */
+	if (*out_cntr == batch_size) {
+	    send_batch(proc_rank, num_procs, out_batch, *out_cntr);
+	    *out_cntr = 0;
+	}
     }
 }
 
 int main(int argc, char *argv[])
 {
-    int num_procs, proc_rank;
-    unsigned input_size;
+    int num_procs, proc_rank, opt;
+    unsigned input_size, batch_size = DEFAULT_BATCH_SIZE;
 
     MPI_Init(&argc, &argv);
     MPI_Comm_size(MPI_COMM_WORLD, &num_procs);
@@ -94,8 +144,20 @@ int main(int argc, char *argv[])
 
     input_size = 1 << (num_procs - 1);
 
+    /* Parse options. */
+    while ((opt = getopt(argc, argv, "b:")) != -1) {
+	if (opt == 'b' && (batch_size = strtoul(optarg, NULL, 10)) > 0) {
+	    continue;
+	}
+	if (proc_rank == ROOT_PROC) {
+	    fprintf(stderr, "Usage: %s [-b batch_size]\n", argv[0]);
+	}
+	MPI_Finalize();
+	return EXIT_FAILURE;
+    }
+
 #ifdef MEASURE_TIME
-    double wall_time, to_reduce_cpu_time, reduced_cpu_time;
+    double wall_time = 0.0, to_reduce_cpu_time, reduced_cpu_time;
     clock_t cpu_time;
 
     MPI_Barrier(MPI_COMM_WORLD);
@@ -108,45 +170,38 @@ int main(int argc, char *argv[])
      * doesn't send anything but prints sorted sequence.
      */
     if (proc_rank == ROOT_PROC) {
-	queue_t *in_que;
-	FILE *in;
-	unsigned char buff[IN_BUFF_SIZE];
-	size_t bytes_read;
-	unsigned first = 1;
-	
-	in_que = queue_init(input_size);
-	if (in_que == NULL) {
-	    perror("queue_init()");
-	    MPI_Abort(MPI_COMM_WORLD, errno);
-	}
+	struct stat in_stat;
+	unsigned char *in_data = NULL;
+	int in_fd;
 
 	/* Open file and check for errors. */
-	in = fopen(FILE_NAME, "r");
-	if (in == NULL) {
+	in_fd = open(FILE_NAME, O_RDONLY);
+	if (in_fd < 0 || fstat(in_fd, &in_stat) != 0) {
 	    perror(FILE_NAME);
 	    MPI_Abort(MPI_COMM_WORLD, errno);
 	}
+	if ((size_t)in_stat.st_size != input_size) {
+	    fprintf(stderr, "%s: %u numbers expected for %d processors\n", FILE_NAME, input_size, num_procs);
+	    MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+	}
 
-	/* Read, print and store bytes in queue. */
-	do {
-	    bytes_read = fread(buff, sizeof(*buff), IN_BUFF_SIZE, in);
-
-	    /* Check errors. */
-	    if (ferror(in)) {
-		perror("fread()");
-		MPI_Abort(MPI_COMM_WORLD, errno);
-	    }
+	/*
+	 * Map the file instead of reading it, pages are read in by the kernel
+	 * (with sequential read-ahead) as they are sent, so the pipeline starts
+	 * working while the rest of the file is still on the disk.
+	 */
+	in_data = mmap(NULL, input_size, PROT_READ, MAP_PRIVATE, in_fd, 0);
+	if (in_data == MAP_FAILED) {
+	    perror("mmap()");
+	    MPI_Abort(MPI_COMM_WORLD, errno);
+	}
+	posix_madvise(in_data, input_size, POSIX_MADV_SEQUENTIAL);
+	close(in_fd);
 
-	    for (size_t i = 0; i < bytes_read; ++i) {
-		if (first) {
-		    first = 0;
-		} else {
-		    IN_PRINT(" ");
-		}
-		IN_PRINT("%hhu", buff[i]);
-		queue_enqueue(in_que, buff[i]);
-	    }
-	} while (!feof(in));
+	/* Print input, it has to be complete before the last processor starts printing. */
+	for (size_t i = 0; i < input_size; ++i) {
+	    IN_PRINT(i > 0 ? " %hhu" : "%hhu", in_data[i]);
+	}
 	IN_PRINT("\n");
 	fflush(stdout);
 
@@ -154,23 +209,29 @@ int main(int argc, char *argv[])
 	wall_time = MPI_Wtime();
 	cpu_time = clock();
 #endif
-	/* Send each number from the queue to the first processor. */
-	while (!queue_empty(in_que)) {
-	    unsigned char to_send = queue_dequeue(in_que);
+	/* Send numbers straight from the mapped file to the first processor in batches. */
+	for (size_t sent = 0; sent < input_size; sent += batch_size) {
+	    const size_t to_send = (input_size - sent < batch_size) ? input_size - sent : batch_size;
 
-	    MPI_Send(&to_send, 1, MPI_CHAR, proc_rank + 1, TAG, MPI_COMM_WORLD);
+	    MPI_Send(in_data + sent, to_send, MPI_CHAR, proc_rank + 1, TAG, MPI_COMM_WORLD);
 	}
-	queue_destroy(in_que);
+	munmap(in_data, input_size);
     } else {
 	const unsigned seq_size = 1 << (proc_rank - 1);
-	unsigned received_cntr = 0;
+	unsigned received_cntr = 0, out_cntr = 0;
+	unsigned char *in_batch, *out_batch;
 
 	queue_t *ques[2] = { 0 };
 
-	ques[0] = queue_init(seq_size + 1);
-	ques[1] = queue_init(seq_size);
-	if (ques[0] == NULL || ques[1] == NULL) {
+	/* Whole sequence plus part of the next one from the same batch. */
+	ques[0] = queue_init(seq_size + batch_size);
+	ques[1] = queue_init(seq_size + batch_size);
+	in_batch = malloc(batch_size);
+	out_batch = malloc(batch_size);
+	if (ques[0] == NULL || ques[1] == NULL || in_batch == NULL || out_batch == NULL) {
 	    perror("queue_init()");
+	    free(out_batch);
+	    free(in_batch);
 	    queue_destroy(ques[1]);
 	    queue_destroy(ques[0]);
 	    MPI_Abort(MPI_COMM_WORLD, errno);
@@ -179,19 +240,24 @@ int main(int argc, char *argv[])
 #ifdef MEASURE_TIME /* Start of non-root processors time measurement. */
 	cpu_time = clock();
 #endif
-	/* Loop until all data processed, AKA until at least one queue is not empty. */
+	/* Loop until all data received and processed, AKA until at least one queue is not empty. */
 	do {
 	    /* Receive and store until got all data. */
 	    if (received_cntr < input_size) {
-		receive_and_store(proc_rank, ques, seq_size, &received_cntr);
+		receive_and_store(proc_rank, ques, seq_size, &received_cntr, in_batch, batch_size);
 	    }
 
-	    /* Merge and send until all data processed. */
-	    if (received_cntr > seq_size) {
-		merge_and_send(proc_rank, ques, seq_size, num_procs);
-	    }
-	} while (!(queue_empty(ques[0]) && queue_empty(ques[1])));
+	    /* Merge and send what is possible. */
+	    merge_and_send(proc_rank, ques, seq_size, num_procs, out_batch, &out_cntr, batch_size);
+	} while (received_cntr < input_size || !(queue_empty(ques[0]) && queue_empty(ques[1])));
+
+	/* Send the last incomplete batch. */
+	if (out_cntr > 0) {
+	    send_batch(proc_rank, num_procs, out_batch, out_cntr);
+	}
 
+	free(out_batch);
+	free(in_batch);
 	queue_destroy(ques[1]);
 	queue_destroy(ques[0]);
     }
@@ -0,0 +1,194 @@
+/*
+ * author: Jan Wrona
+ * email: <xwrona00@stud.fit.vutbr.cz>
+ *
+ * Micro-benchmark of queue.h. Streams bytes through a queue in batches, the
+ * same way pipeline merge sort stage does, using:
+ *  - modulo: former byte by byte queue with % indexing (reference),
+ *  - masked: queue_enqueue()/queue_dequeue() byte by byte,
+ *  - bulk: queue_enqueue_bulk()/queue_dequeue_bulk(),
+ *  - spans: queue_dequeue_spans() and reading the spans in place.
+ * Every variant folds all dequeued bytes in order into a checksum, which has
+ * to match the one of the enqueued bytes.
+ *
+ * Compilation: cc -std=c11 -O2 -o queue-bench queue-bench.c
+ * Usage: ./queue-bench [bytes [batch_size [capacity]]]
+ */
+
+#define _POSIX_C_SOURCE 200809L /* clock_gettime() with -std=c11 */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "queue.h"
+
+#define DEFAULT_BYTES (1UL << 28)
+#define DEFAULT_BATCH_SIZE 1024
+#define DEFAULT_CAPACITY (1UL << 16)
+#define RUNS 3
+
+/* Former queue: one spare element, head and tail wrapped by modulo. */
+typedef struct {
+    unsigned char *data;
+    size_t size, head, tail;
+} mod_queue_t;
+
+static void mod_enqueue(mod_queue_t *q, unsigned char new_elem)
+{
+    if (q->head == ((q->tail + (q->size - 1)) % q->size)) {
+	return;
+    }
+    q->data[q->head] = new_elem;
+    q->head = (q->head + 1) % q->size;
+}
+
+static unsigned char mod_dequeue(mod_queue_t *q)
+{
+    unsigned char ret;
+
+    if (q->head == q->tail) {
+	return 0;
+    }
+    ret = q->data[q->tail];
+    q->tail = (q->tail + 1) % q->size;
+
+    return ret;
+}
+
+static double wtime(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double min_time(double best, double elapsed)
+{
+    return (elapsed < best) ? elapsed : best;
+}
+
+/* Order sensitive checksum, add size bytes from data to sum. */
+static unsigned long checksum_add(unsigned long sum, const unsigned char *data, size_t size)
+{
+    for (size_t i = 0; i < size; ++i) {
+	sum = sum * 31 + data[i];
+    }
+
+    return sum;
+}
+
+int main(int argc, char *argv[])
+{
+    const size_t bytes = (argc > 1) ? strtoul(argv[1], NULL, 10) : DEFAULT_BYTES;
+    const size_t batch_size = (argc > 2) ? strtoul(argv[2], NULL, 10) : DEFAULT_BATCH_SIZE;
+    const size_t capacity = (argc > 3) ? strtoul(argv[3], NULL, 10) : DEFAULT_CAPACITY;
+    double best[4] = { 1e9, 1e9, 1e9, 1e9 };
+    unsigned long checksum[4] = { 0 }, expected = 0;
+    unsigned char *in_batch, *out_batch;
+    mod_queue_t mod_q;
+    queue_t *q;
+
+    if (batch_size == 0 || batch_size > capacity) {
+	fprintf(stderr, "Usage: %s [bytes [batch_size [capacity]]], batch_size <= capacity\n", argv[0]);
+	return EXIT_FAILURE;
+    }
+
+    in_batch = malloc(batch_size);
+    out_batch = malloc(batch_size);
+    mod_q.data = malloc(capacity + 1);
+    mod_q.size = capacity + 1;
+    q = queue_init(capacity);
+    if (in_batch == NULL || out_batch == NULL || mod_q.data == NULL || q == NULL) {
+	perror("malloc()");
+	return EXIT_FAILURE;
+    }
+    for (size_t i = 0; i < batch_size; ++i) {
+	in_batch[i] = rand();
+    }
+    for (size_t done = 0; done < bytes; done += batch_size) {
+	expected = checksum_add(expected, in_batch, batch_size);
+    }
+
+    for (unsigned run = 0; run < RUNS; ++run) {
+	double start;
+
+	/* modulo */
+	mod_q.head = mod_q.tail = 0;
+	checksum[0] = 0;
+	start = wtime();
+	for (size_t done = 0; done < bytes; done += batch_size) {
+	    for (size_t i = 0; i < batch_size; ++i) {
+		mod_enqueue(&mod_q, in_batch[i]);
+	    }
+	    for (size_t i = 0; i < batch_size; ++i) {
+		out_batch[i] = mod_dequeue(&mod_q);
+	    }
+	    checksum[0] = checksum_add(checksum[0], out_batch, batch_size);
+	}
+	best[0] = min_time(best[0], wtime() - start);
+
+	/* masked */
+	q->head = q->tail = 0;
+	checksum[1] = 0;
+	start = wtime();
+	for (size_t done = 0; done < bytes; done += batch_size) {
+	    for (size_t i = 0; i < batch_size; ++i) {
+		queue_enqueue(q, in_batch[i]);
+	    }
+	    for (size_t i = 0; i < batch_size; ++i) {
+		out_batch[i] = queue_dequeue(q);
+	    }
+	    checksum[1] = checksum_add(checksum[1], out_batch, batch_size);
+	}
+	best[1] = min_time(best[1], wtime() - start);
+
+	/* bulk */
+	q->head = q->tail = 0;
+	checksum[2] = 0;
+	start = wtime();
+	for (size_t done = 0; done < bytes; done += batch_size) {
+	    queue_enqueue_bulk(q, in_batch, batch_size);
+	    queue_dequeue_bulk(q, out_batch, batch_size);
+	    checksum[2] = checksum_add(checksum[2], out_batch, batch_size);
+	}
+	best[2] = min_time(best[2], wtime() - start);
+
+	/* spans, elements read in place without copying them out */
+	q->head = q->tail = 0;
+	checksum[3] = 0;
+	start = wtime();
+	for (size_t done = 0; done < bytes; done += batch_size) {
+	    queue_span_t spans[2];
+	    size_t count;
+
+	    queue_enqueue_bulk(q, in_batch, batch_size);
+	    count = queue_dequeue_spans(q, batch_size, spans);
+	    checksum[3] = checksum_add(checksum[3], spans[0].data, spans[0].size);
+	    checksum[3] = checksum_add(checksum[3], spans[1].data, spans[1].size);
+	    queue_dequeue_commit(q, count);
+	}
+	best[3] = min_time(best[3], wtime() - start);
+    }
+
+    if (checksum[0] != expected || checksum[1] != expected || checksum[2] != expected
+	    || checksum[3] != expected) {
+	fprintf(stderr, "Error: queues returned different data.\n");
+	return EXIT_FAILURE;
+    }
+
+    printf("bytes: %zu, batch: %zu, capacity: %zu\n", bytes, batch_size, capacity);
+    printf("method time[s] MB/s\n");
+    printf("modulo %f %.1f\n", best[0], bytes / best[0] / 1e6);
+    printf("masked %f %.1f\n", best[1], bytes / best[1] / 1e6);
+    printf("bulk %f %.1f\n", best[2], bytes / best[2] / 1e6);
+    printf("spans %f %.1f\n", best[3], bytes / best[3] / 1e6);
+
+    queue_destroy(q);
+    free(mod_q.data);
+    free(out_batch);
+    free(in_batch);
+
+    return EXIT_SUCCESS;
+}
@@ -1,13 +1,33 @@
+/*
+ * author: Jan Wrona
+ * email: <xwrona00@stud.fit.vutbr.cz>
+ *
+ * Implementation of simple FIFO queue.
+ *
+ * Capacity is rounded up to a power of two, head and tail are free running
+ * counters and position in data is obtained by masking. Besides single
+ * element operations queue offers bulk ones: up to two contiguous spans
+ * (till the end of data and from its beginning) are handed back for direct
+ * access and then committed, or copied with memcpy.
+ */
+
 #ifndef QUEUE_H
 #define QUEUE_H
 
 #include <stdlib.h>
+#include <string.h>
 
 typedef struct {
     unsigned char *data;
-    size_t size, head, tail;
+    size_t size, mask; /* size is power of two, mask is size - 1 */
+    size_t head, tail; /* free running, head for enqueue, tail for dequeue */
 } queue_t;
 
+typedef struct {
+    unsigned char *data;
+    size_t size;
+} queue_span_t;
+
 queue_t *queue_init(const size_t elements)
 {
     queue_t *q;
@@ -17,7 +37,11 @@ queue_t *queue_init(const size_t elements)
 	return NULL;
     }
 
-    q->size = elements + 1;
+    q->size = 1;
+    while (q->size < elements) {
+	q->size <<= 1;
+    }
+    q->mask = q->size - 1;
     q->data = malloc(q->size * sizeof(unsigned char));
     if (q->data == NULL) {
 	free(q);
@@ -35,6 +59,11 @@ void queue_destroy(queue_t *q)
     free(q);
 }
 
+size_t queue_count(const queue_t *q)
+{
+    return (q->head - q->tail);
+}
+
 unsigned queue_empty(const queue_t *q)
 {
     return (q->head == q->tail);
@@ -42,7 +71,7 @@ unsigned queue_empty(const queue_t *q)
 
 unsigned queue_full(const queue_t *q)
 {
-    return (q->head == ((q->tail + (q->size - 1)) % q->size));
+    return (queue_count(q) == q->size);
 }
 
 void queue_enqueue(queue_t *q, unsigned char new_elem)
@@ -51,22 +80,16 @@ void queue_enqueue(queue_t *q, unsigned char new_elem)
         return; /* queue full, enqueue nothing */
     }
 
-    q->data[q->head] = new_elem;
-    q->head = (q->head + 1) % q->size;
+    q->data[q->head++ & q->mask] = new_elem;
 }
 
 unsigned char queue_dequeue(queue_t *q)
 {
-    unsigned char ret;
-
     if (queue_empty(q)) {
         return 0; /* queue empty, dequeue nothing */
     }
 
-    ret = q->data[q->tail];
-    q->tail = (q->tail + 1) % q->size;
-
-    return ret;
+    return q->data[q->tail++ & q->mask];
 }
 
 unsigned char queue_front(queue_t *q)
@@ -75,7 +98,81 @@ unsigned char queue_front(queue_t *q)
         return 0; /* queue empty */
     }
 
-    return q->data[q->tail];
+    return q->data[q->tail & q->mask];
+}
+
+/*
+ * Split count elements starting at position pos into at most two spans.
+ */
+static size_t queue_spans(const queue_t *q, size_t pos, size_t count, queue_span_t spans[2])
+{
+    const size_t index = pos & q->mask;
+
+    spans[0].data = q->data + index;
+    spans[0].size = (count < q->size - index) ? count : q->size - index;
+    spans[1].data = q->data;
+    spans[1].size = count - spans[0].size;
+
+    return count;
+}
+
+/*
+ * Free space for up to count new elements. Fill the spans and make the
+ * elements available by queue_enqueue_commit(). Returns total size of spans.
+ */
+size_t queue_enqueue_spans(const queue_t *q, size_t count, queue_span_t spans[2])
+{
+    const size_t free_cnt = q->size - queue_count(q);
+
+    return queue_spans(q, q->head, (count < free_cnt) ? count : free_cnt, spans);
+}
+
+void queue_enqueue_commit(queue_t *q, size_t count)
+{
+    q->head += count;
+}
+
+/*
+ * Up to count oldest elements. Read the spans and release the elements
+ * by queue_dequeue_commit(). Returns total size of spans.
+ */
+size_t queue_dequeue_spans(const queue_t *q, size_t count, queue_span_t spans[2])
+{
+    const size_t stored_cnt = queue_count(q);
+
+    return queue_spans(q, q->tail, (count < stored_cnt) ? count : stored_cnt, spans);
+}
+
+void queue_dequeue_commit(queue_t *q, size_t count)
+{
+    q->tail += count;
+}
+
+/*
+ * Copy up to count elements in/out of the queue, return number of copied.
+ */
+size_t queue_enqueue_bulk(queue_t *q, const unsigned char *src, size_t count)
+{
+    queue_span_t spans[2];
+
+    count = queue_enqueue_spans(q, count, spans);
+    memcpy(spans[0].data, src, spans[0].size);
+    memcpy(spans[1].data, src + spans[0].size, spans[1].size);
+    queue_enqueue_commit(q, count);
+
+    return count;
+}
+
+size_t queue_dequeue_bulk(queue_t *q, unsigned char *dst, size_t count)
+{
+    queue_span_t spans[2];
+
+    count = queue_dequeue_spans(q, count, spans);
+    memcpy(dst, spans[0].data, spans[0].size);
+    memcpy(dst + spans[0].size, spans[1].data, spans[1].size);
+    queue_dequeue_commit(q, count);
+
+    return count;
 }
 
 #endif /* QUEUE_H */
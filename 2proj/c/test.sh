@@ -2,7 +2,7 @@
 #author: Jan Wrona
 #email: <xwrona00@stud.fit.vutbr.cz>
 
-USAGE="Usage: ${0} problem_size"
+USAGE="Usage: ${0} problem_size [batch_size]"
 MPIPATH="/usr/local/share/OpenMPI/bin/"
 NAME="pms"
 
@@ -13,6 +13,13 @@ then
     exit 1
 fi
 
+#batch_size is number of elements sent in one message (default in source)
+if [[ -n $2 && ! $2 =~ ^[1-9][0-9]*$ ]]
+then
+    echo "${USAGE}"
+    exit 1
+fi
+
 PS=`echo "${1}" | bc` #exp to int
 PS="${PS%.*}" #remove floating point
 LOG_FLOAT=`echo "l(${PS})/l(2)" | bc -l`
@@ -38,7 +45,7 @@ dd if=/dev/urandom bs=1 count="${PS}" of=numbers 2> /dev/null
 "${MPIPATH}mpicc" -std=c11 -DNMEASURE_TIME -DPRINT_IN -DPRINT_OUT -o "${NAME}" "${NAME}.c"
 
 #run
-"${MPIPATH}mpirun" -np "${CPUS}" "${NAME}" #> sorted_pms.txt
+"${MPIPATH}mpirun" -np "${CPUS}" "${NAME}" ${2:+-b "${2}"} #> sorted_pms.txt
 
 #cmp sorted_{sort,pms}.txt
 
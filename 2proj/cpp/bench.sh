@@ -0,0 +1,72 @@
+#!/usr/bin/env bash
+#author: Jan Wrona
+#email: xwrona00@stud.fit.vutbr.cz
+
+#Compares fan-in of merging stages at fixed problem size. For every fan_in
+#runs ceil(log_fan_in(problem_size / run_length)) + 1 processors and prints
+#their count and walltime (best of RUNS runs).
+
+USAGE="Usage: ${0} problem_size [batch_size [run_length]]"
+MPIPATH="/usr/local/share/OpenMPI/bin/"
+NAME="pms"
+FAN_INS="2 4 8 16"
+RUNS=3
+
+#problem_size is integer (e.g. 1024) or integer with exponent (e.g. 2^10)
+if [[ ! $1 =~ ^[0-9]+(\^[0-9]+)?$ ]]
+then
+    echo "${USAGE}"
+    exit 1
+fi
+
+#batch_size is number of elements sent in one message (default in source)
+if [[ -n $2 && ! $2 =~ ^[1-9][0-9]*$ ]]
+then
+    echo "${USAGE}"
+    exit 1
+fi
+
+#run_length is length of runs presorted by the first processor
+if [[ -n $3 && ! $3 =~ ^[1-9][0-9]*$ ]]
+then
+    echo "${USAGE}"
+    exit 1
+fi
+RUN_LENGTH="${3:-1}"
+
+PS=`echo "${1}" | bc` #exp to int
+PS="${PS%.*}" #remove floating point
+
+#create random input file
+dd if=/dev/urandom bs=1 count="${PS}" of=numbers 2> /dev/null
+
+#compilation
+"${MPIPATH}mpic++" -Ofast -DNO_OUT -DMEASURE_TIME -o "${NAME}" "${NAME}.cpp"
+
+echo "fan_in cpus walltime"
+for FAN_IN in ${FAN_INS}
+do
+    #ceil(log_fan_in(problem_size / run_length))
+    LOG=0
+    MERGED=${RUN_LENGTH}
+    while [ ${MERGED} -lt ${PS} ]
+    do
+	LOG=$((LOG+1))
+	MERGED=$((MERGED*FAN_IN))
+    done
+    CPUS=$((LOG+1))
+
+    BEST=""
+    for RUN in `seq ${RUNS}`
+    do
+	TIME=`"${MPIPATH}mpirun" -np "${CPUS}" "${NAME}" ${2:+-b "${2}"} -k "${FAN_IN}" -r "${RUN_LENGTH}" | sed -n 's/^walltime: //p'`
+	if [[ -z ${BEST} ]] || (( $(echo "${TIME} < ${BEST}" | bc) ))
+	then
+	    BEST="${TIME}"
+	fi
+    done
+    echo "${FAN_IN} ${CPUS} ${BEST}"
+done
+
+#cleanup
+rm -f "${NAME}" numbers
@@ -0,0 +1,93 @@
+/*
+ * author: Jan Wrona
+ * email: <xwrona00@stud.fit.vutbr.cz>
+ *
+ * Tournament (loser) tree for k-way merging. Every inner node remembers the
+ * loser of the match played there, the overall winner is kept in node 0.
+ * After the winning leaf gets a new key (or runs out of them), only the
+ * matches on its path to the root are replayed, so selecting the next
+ * smallest key costs log2(k) comparisons.
+ */
+
+#ifndef LOSER_TREE_H
+#define LOSER_TREE_H
+
+#include <vector> /* std::vector */
+#include <utility> /* std::swap */
+
+template <typename T>
+class LoserTree {
+public:
+    /* Constructors. */
+    LoserTree(unsigned ways);
+
+    /* Methods. */
+    void set(unsigned leaf, const T &key) { keys[leaf] = key; exhausted[leaf] = false; };
+    void set_exhausted(unsigned leaf) { exhausted[leaf] = true; };
+    void build(void);
+    void replay(unsigned leaf);
+
+    /* Getters. */
+    unsigned const& get_winner() const { return nodes[0]; };
+    bool is_exhausted(unsigned leaf) const { return exhausted[leaf]; };
+
+private:
+    /* Exhausted leaf loses every match, equal keys are won by the lower leaf. */
+    bool wins(unsigned a, unsigned b) const
+    {
+	return !exhausted[a] && (exhausted[b] || keys[a] < keys[b] || (!(keys[b] < keys[a]) && a < b));
+    };
+
+    unsigned leaves; //number of ways rounded up to a power of two
+    std::vector<T> keys;
+    std::vector<bool> exhausted;
+    std::vector<unsigned> nodes; //losers in 1..leaves-1, winner in 0
+    std::vector<unsigned> winners; //winners of all nodes and leaves, only while building
+};
+
+template <typename T>
+LoserTree<T>::LoserTree(unsigned ways): leaves(1)
+{
+    while (leaves < ways) {
+	leaves <<= 1;
+    }
+    keys.resize(leaves);
+    exhausted.assign(leaves, true); //padding leaves never win
+    nodes.resize(leaves);
+    winners.resize(2 * leaves);
+}
+
+template <typename T>
+void LoserTree<T>::build(void)
+{
+    for (unsigned i = 0; i < leaves; ++i) {
+	winners[leaves + i] = i;
+    }
+    for (unsigned node = leaves - 1; node > 0; --node) {
+	const unsigned left = winners[2 * node], right = winners[2 * node + 1];
+
+	if (wins(left, right)) {
+	    winners[node] = left;
+	    nodes[node] = right;
+	} else {
+	    winners[node] = right;
+	    nodes[node] = left;
+	}
+    }
+    nodes[0] = (leaves > 1) ? winners[1] : 0;
+}
+
+template <typename T>
+void LoserTree<T>::replay(unsigned leaf)
+{
+    unsigned winner = leaf;
+
+    for (unsigned node = (leaves + leaf) / 2; node > 0; node /= 2) {
+	if (wins(nodes[node], winner)) {
+	    std::swap(nodes[node], winner);
+	}
+    }
+    nodes[0] = winner;
+}
+
+#endif //LOSER_TREE_H
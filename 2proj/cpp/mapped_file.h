@@ -0,0 +1,138 @@
+/*
+ * author: Jan Wrona
+ * email: <xwrona00@stud.fit.vutbr.cz>
+ *
+ * Private read-write mapping of a whole file. Nothing is read up front, the
+ * kernel reads pages in (with sequential read-ahead) when they are touched
+ * for the first time, so the file can be processed while it is still being
+ * read. Writes go to private copies of the pages, the file stays untouched.
+ *
+ * TempMapping is a shared mapping of a new, allready unlinked, temporary
+ * file. Its pages are backed by the file instead of swap, so the kernel may
+ * write them out and drop them from memory any time and read them back when
+ * touched again. Memory usage is bounded by the page cache, not by the size.
+ */
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string> /* std::string */
+#include <stdexcept> /* std::runtime_error */
+#include <cstring> /* std::strerror */
+#include <cerrno>
+#include <cstdlib> /* std::getenv, mkstemp */
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+class MappedFile {
+public:
+    /* Constructors. */
+    MappedFile(const std::string &file_name);
+    ~MappedFile();
+
+    /* Getters. */
+    unsigned char* get_data() const { return data; };
+    std::size_t const& get_size() const { return size; };
+
+private:
+    MappedFile(const MappedFile&); //not copyable, owns mapping
+    MappedFile& operator=(const MappedFile&);
+
+    unsigned char *data = nullptr;
+    std::size_t size = 0;
+};
+
+inline MappedFile::MappedFile(const std::string &file_name)
+{
+    struct stat file_stat;
+    const int fd = open(file_name.c_str(), O_RDONLY);
+
+    if (fd < 0 || fstat(fd, &file_stat) != 0) {
+	const int err = errno;
+
+	if (fd >= 0) {
+	    close(fd);
+	}
+	throw std::runtime_error(std::string(std::strerror(err)) + " \"" + file_name + "\"");
+    }
+    size = file_stat.st_size;
+
+    /* Empty file can't be mapped, but there is nothing to read anyway. */
+    if (size > 0) {
+	void *mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+
+	if (mapping == MAP_FAILED) {
+	    const int err = errno;
+
+	    close(fd);
+	    throw std::runtime_error(std::string("mmap(): ") + std::strerror(err) + " \"" + file_name + "\"");
+	}
+	data = static_cast<unsigned char *>(mapping);
+	posix_madvise(data, size, POSIX_MADV_SEQUENTIAL);
+    }
+    close(fd); //mapping stays valid
+}
+
+inline MappedFile::~MappedFile()
+{
+    if (data != nullptr) {
+	munmap(data, size);
+    }
+}
+
+class TempMapping {
+public:
+    /* Constructors, file is created in $TMPDIR or /tmp. */
+    TempMapping(std::size_t size);
+    ~TempMapping();
+
+    /* Getters. */
+    void* get_data() const { return data; };
+    std::size_t const& get_size() const { return size; };
+
+private:
+    TempMapping(const TempMapping&); //not copyable, owns mapping
+    TempMapping& operator=(const TempMapping&);
+
+    void *data = nullptr;
+    std::size_t size;
+};
+
+inline TempMapping::TempMapping(std::size_t size): size(size)
+{
+    const char *dir = std::getenv("TMPDIR");
+    std::string file_name = std::string((dir && *dir) ? dir : "/tmp") + "/pms-spill-XXXXXX";
+    const int fd = mkstemp(&file_name[0]);
+
+    if (fd < 0) {
+	throw std::runtime_error(std::string("mkstemp(): ") + std::strerror(errno) + " \"" + file_name + "\"");
+    }
+    unlink(file_name.c_str()); //removed as soon as the mapping is gone
+
+    /* Sparse file, blocks are allocated only when written. */
+    if (ftruncate(fd, size) != 0) {
+	const int err = errno;
+
+	close(fd);
+	throw std::runtime_error(std::string("ftruncate(): ") + std::strerror(err) + " \"" + file_name + "\"");
+    }
+    data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+	const int err = errno;
+
+	close(fd);
+	throw std::runtime_error(std::string("mmap(): ") + std::strerror(err) + " \"" + file_name + "\"");
+    }
+    posix_madvise(data, size, POSIX_MADV_SEQUENTIAL);
+    close(fd); //mapping stays valid
+}
+
+inline TempMapping::~TempMapping()
+{
+    munmap(data, size);
+}
+
+#endif //MAPPED_FILE_H
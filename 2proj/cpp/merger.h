@@ -0,0 +1,264 @@
+/*
+ * author: Jan Wrona
+ * email: <xwrona00@stud.fit.vutbr.cz>
+ *
+ * Merging part of one pipeline merge sort stage, independent of how numbers
+ * get in and out (MPI messages or queues between threads). Stored numbers
+ * are sequences of length seq_size, every fan_in of them are merged into one
+ * sequence. Pairs are merged straight from the que spans, more sequences
+ * through a loser tree. Ques of a stage that would need more than mem_budget
+ * bytes are spilled to temporary files and merged back as they are read in.
+ */
+
+#ifndef MERGER_H
+#define MERGER_H
+
+#include <vector> /* std::vector */
+#include <algorithm> /* std::min, std::max, std::copy */
+#include <cstddef> /* std::size_t */
+
+#include "ring_buffer.h"
+#include "loser_tree.h"
+
+class Merger {
+public:
+    /* Constructors. */
+    Merger(unsigned stage, unsigned input_size, unsigned batch_size, unsigned fan_in, unsigned run_length, std::size_t mem_budget);
+
+    /* Methods, return number of numbers really stored/merged. */
+    std::size_t store(const unsigned char *batch, std::size_t count);
+    std::size_t merge(unsigned char *out, std::size_t out_free);
+
+    /* Getters. */
+    bool received() const { return received_cntr == input_size; };
+    bool merged() const { return merged_cntr == input_size; };
+    std::size_t ques_size() const;
+    bool const& get_spill() const { return spill; };
+
+private:
+    std::size_t merge_2(unsigned char *out, std::size_t out_free);
+    std::size_t merge_k(unsigned char *out, std::size_t out_free);
+    void next_sequences(void);
+
+    /* Length of i-th sequence being merged, the last ones may be shorter or missing. */
+    unsigned seq_len(unsigned i) const
+    {
+	const unsigned rest = input_size - merged_cntr;
+	return (rest > i * seq_size) ? std::min(seq_size, rest - i * seq_size) : 0;
+    };
+
+    const unsigned input_size, fan_in;
+    unsigned seq_size;
+    unsigned received_cntr = 0;
+
+    /* One que for each sequence being merged. */
+    std::vector<RingBuffer<unsigned char>> ques;
+    bool spill = false; //ques are in temporary files
+    std::vector<unsigned> que_popped;
+    unsigned merged_cntr = 0; //elements of all previously merged sequences
+    LoserTree<unsigned char> tree;
+    bool tree_built = false;
+    int tree_pending = -1; //leaf waiting for its next element
+};
+
+/*
+ * Que holds at most the rest of one sequence and one batch, so nothing is
+ * allocated after construction.
+ */
+inline Merger::Merger(unsigned stage, unsigned input_size, unsigned batch_size, unsigned fan_in, unsigned run_length, std::size_t mem_budget):
+	input_size(input_size), fan_in(fan_in), que_popped(fan_in, 0), tree(fan_in)
+{
+    /* run_length * fan_in^(stage - 1), longer sequences than the input behave the same. */
+    unsigned long long size = run_length;
+    for (unsigned i = 1; i < stage && size < input_size; ++i) {
+	size *= fan_in;
+    }
+    seq_size = std::max(1ull, std::min<unsigned long long>(size, input_size));
+
+    /*
+     * All fan_in - 1 sequences have to be stored before the last one arrives,
+     * so memory of the last stages grows with input size. Such stage keeps
+     * its ques in files, the kernel writes them out and reads them back.
+     */
+    spill = mem_budget > 0 && static_cast<unsigned long long>(fan_in) * (seq_size + batch_size) > mem_budget;
+    ques.reserve(fan_in);
+    for (unsigned i = 0; i < fan_in; ++i) {
+	ques.emplace_back(seq_size + batch_size, spill);
+    }
+}
+
+/*
+ * Stores numbers while there is space in the que of their sequence. Space
+ * runs out only when merged numbers aren't taken away.
+ */
+inline std::size_t Merger::store(const unsigned char *batch, std::size_t count)
+{
+    std::size_t stored = 0;
+
+    while (stored < count) {
+	/* Numbers up to the end of received sequence go to the same que. */
+	const unsigned store_que_index = (received_cntr / seq_size) % fan_in;
+	const std::size_t to_store = std::min<std::size_t>(count - stored, seq_size - received_cntr % seq_size);
+	const std::size_t pushed = ques[store_que_index].push(batch + stored, to_store);
+
+	stored += pushed;
+	received_cntr += pushed;
+	if (pushed < to_store) {
+	    break;
+	}
+    }
+
+    return stored;
+}
+
+/*
+ * Merges at most out_free numbers, stops earlier when the smallest number of
+ * some sequence isn't stored yet.
+ */
+inline std::size_t Merger::merge(unsigned char *out, std::size_t out_free)
+{
+    return (fan_in == 2) ? merge_2(out, out_free) : merge_k(out, out_free);
+}
+
+inline std::size_t Merger::ques_size() const
+{
+    std::size_t size = 0;
+
+    for (unsigned i = 0; i < fan_in; ++i) {
+	size += ques[i].size();
+    }
+
+    return size;
+}
+
+inline std::size_t Merger::merge_2(unsigned char *out, std::size_t out_free)
+{
+    std::size_t out_cntr = 0;
+
+    /* Merge while the smallest element of both sequences is known. */
+    while (out_cntr < out_free) {
+	/* The last sequence may be shorter or missing when input size isn't a power of two. */
+	const unsigned seq_len[2] = { this->seq_len(0), this->seq_len(1) };
+
+	/* Contiguous received parts of both sequences. */
+	const unsigned char *spans[2];
+	std::size_t span_sizes[2];
+	for (unsigned i = 0; i < 2; ++i) {
+	    span_sizes[i] = std::min<std::size_t>(ques[i].read_span(spans[i]), seq_len[i] - que_popped[i]);
+	}
+
+	unsigned char *dst = out + out_cntr;
+	const std::size_t dst_free = out_free - out_cntr;
+	std::size_t taken[2] = { 0, 0 };
+
+	/* One que allready empty for this sequece? Use elements from the second one. */
+	if (que_popped[0] == seq_len[0] || que_popped[1] == seq_len[1]) {
+	    const unsigned send_que_index = (que_popped[0] == seq_len[0]);
+
+	    taken[send_que_index] = std::min(span_sizes[send_que_index], dst_free);
+	    std::copy(spans[send_que_index], spans[send_que_index] + taken[send_que_index], dst);
+
+	/* Both ques available? Compare front elements. */
+	} else {
+	    for (std::size_t i = 0; i < dst_free && taken[0] < span_sizes[0] && taken[1] < span_sizes[1]; ++i) {
+		if (spans[0][taken[0]] <= spans[1][taken[1]]) { //possible to switch <= to > for reverse order
+		    dst[i] = spans[0][taken[0]++];
+		} else {
+		    dst[i] = spans[1][taken[1]++];
+		}
+	    }
+	}
+
+	/* Element of one sequence not received yet? Wait for it. */
+	if (taken[0] + taken[1] == 0) {
+	    break;
+	}
+
+	/* Remove elements from ques. */
+	for (unsigned i = 0; i < 2; ++i) {
+	    ques[i].pop(taken[i]);
+	    que_popped[i] += taken[i];
+	}
+	out_cntr += taken[0] + taken[1];
+
+	/* Both ques are fully popped for this sequence? Clear counters. */
+	if (que_popped[0] + que_popped[1] == seq_len[0] + seq_len[1]) {
+	    next_sequences();
+	}
+    }
+
+    return out_cntr;
+}
+
+inline std::size_t Merger::merge_k(unsigned char *out, std::size_t out_free)
+{
+    std::size_t out_cntr = 0;
+
+    /* Merge while the smallest element of all sequences is known. */
+    while (out_cntr < out_free && merged_cntr < input_size) {
+	/* New sequences? Play the whole tournament once the front of each is known. */
+	if (!tree_built) {
+	    for (unsigned i = 0; i < fan_in; ++i) {
+		if (seq_len(i) == 0) {
+		    tree.set_exhausted(i);
+		} else if (ques[i].empty()) {
+		    return out_cntr;
+		} else {
+		    tree.set(i, ques[i].front());
+		}
+	    }
+	    tree.build();
+	    tree_built = true;
+
+	/* Next element of the last winner not received yet? Wait for it. */
+	} else if (tree_pending >= 0) {
+	    if (ques[tree_pending].empty()) {
+		return out_cntr;
+	    }
+	    tree.set(tree_pending, ques[tree_pending].front());
+	    tree.replay(tree_pending);
+	    tree_pending = -1;
+	}
+
+	/* Store and remove the winner. */
+	const unsigned winner = tree.get_winner();
+	out[out_cntr++] = ques[winner].front();
+	ques[winner].pop();
+	que_popped[winner]++;
+
+	/* All ques are fully popped for these sequences? Start new ones. */
+	if (que_popped[winner] == seq_len(winner)) {
+	    unsigned popped = 0, len = 0;
+
+	    for (unsigned i = 0; i < fan_in; ++i) {
+		popped += que_popped[i];
+		len += seq_len(i);
+	    }
+	    if (popped == len) {
+		next_sequences();
+	    } else {
+		tree.set_exhausted(winner);
+		tree.replay(winner);
+	    }
+	} else if (ques[winner].empty()) {
+	    tree_pending = winner;
+	} else {
+	    tree.set(winner, ques[winner].front());
+	    tree.replay(winner);
+	}
+    }
+
+    return out_cntr;
+}
+
+inline void Merger::next_sequences(void)
+{
+    for (unsigned i = 0; i < fan_in; ++i) {
+	merged_cntr += que_popped[i];
+	que_popped[i] = 0;
+    }
+    tree_built = false;
+    tree_pending = -1;
+}
+
+#endif //MERGER_H
@@ -0,0 +1,45 @@
+/*
+ * author: Jan Wrona
+ * email: <xwrona00@stud.fit.vutbr.cz>
+ *
+ * Handling of numbers at both ends of the pipeline, shared by pms.cpp and
+ * pms-threads.cpp: the first stage sorts runs of the input, the last one
+ * prints sorted numbers.
+ */
+
+#ifndef NUMBERS_IO_H
+#define NUMBERS_IO_H
+
+#include <algorithm> /* std::fill_n */
+#include <cstddef> /* std::size_t */
+
+#include "../../common/output_sink.h"
+
+/* Sort one run of numbers in place by counting, numbers are bytes. */
+inline void sort_run(unsigned char *run, const std::size_t run_size)
+{
+    std::size_t counts[256] = { 0 };
+
+    for (std::size_t i = 0; i < run_size; ++i) {
+	counts[run[i]]++;
+    }
+    for (unsigned value = 0; value < 256; ++value) {
+	run = std::fill_n(run, counts[value], value);
+    }
+}
+
+/*
+ * Print sorted numbers one per line, or write them as they are in binary mode.
+ */
+inline void print_numbers(OutputSink &out, const unsigned char *numbers, const std::size_t count)
+{
+    if (out.get_mode() == OutputSink::BINARY) {
+	out.write_raw(numbers, count);
+    } else {
+	for (std::size_t i = 0; i < count; ++i) {
+	    out << static_cast<unsigned>(numbers[i]) << '\n';
+	}
+    }
+}
+
+#endif //NUMBERS_IO_H
@@ -0,0 +1,313 @@
+/*
+ * author: Jan Wrona
+ * email: <xwrona00@stud.fit.vutbr.cz>
+ *
+ * Pipeline merge sort with stages as threads of one process instead of MPI
+ * processes. Stage i is pinned to core i (modulo number of cores) and
+ * passes merged numbers to stage i + 1 through a lock-free SPSC queue in
+ * batches, merging straight into the queue. Input, options and output are
+ * the same as of pms.cpp, every stage merges by the same Merger.
+ *
+ * Requires C++17, queues have cache line aligned members and only C++17 new
+ * honours their alignment (see bench-threads.sh):
+ * g++ -std=c++17 -pthread -O2 -o pms-threads pms-threads.cpp
+ */
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <limits>
+#include <thread>
+#include <chrono>
+
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "merger.h"
+#include "spsc_queue.h"
+#include "mapped_file.h"
+#include "numbers_io.h"
+
+#define FILE_NAME "numbers"
+#define DEFAULT_BATCH_SIZE 1024 //elements handed over at once, -b option
+#define DEFAULT_FAN_IN 2 //sequences merged by one stage, -k option
+#define MAX_FAN_IN 16
+#define DEFAULT_RUN_LENGTH 1 //length of runs presorted by root, -r option
+#define DEFAULT_MEM_BUDGET 0 //bytes of ques per stage before spilling to disk, -m option (0 = never)
+#define QUEUE_BATCHES 4 //capacity of queue between stages in batches
+
+typedef SpscQueue<unsigned char> Queue;
+
+/*
+ * One stage of the pipeline. Takes sequences from the queue of preceding
+ * stage, merges them into the queue of succeeding stage (the last stage
+ * prints them instead).
+ */
+class ThreadStage {
+public:
+    /* Constructors. */
+    ThreadStage(unsigned stage, unsigned input_size, unsigned batch_size, unsigned fan_in, unsigned run_length, std::size_t mem_budget, Queue *in_que, Queue *out_que, OutputSink *out);
+
+    /* Methods. */
+    void run(void);
+
+    /* Getters. */
+    std::size_t const& get_ques_max_size() const { return ques_max_size; };
+    bool const& get_spill() const { return merger.get_spill(); };
+
+private:
+    const unsigned batch_size;
+    Merger merger;
+    Queue *in_que, *out_que;
+    std::vector<unsigned char> out_batch; //the last stage only
+    OutputSink *out;
+
+    std::size_t ques_max_size = 0; //in memory, spilled ques are not counted
+};
+
+ThreadStage::ThreadStage(unsigned stage, unsigned input_size, unsigned batch_size, unsigned fan_in, unsigned run_length, std::size_t mem_budget, Queue *in_que, Queue *out_que, OutputSink *out):
+	batch_size(batch_size), merger(stage, input_size, batch_size, fan_in, run_length, mem_budget),
+	in_que(in_que), out_que(out_que), out(out)
+{
+    if (out_que == nullptr) {
+	out_batch.resize(batch_size);
+    }
+}
+
+void ThreadStage::run(void)
+{
+    while (!merger.merged()) {
+	std::size_t moved = 0;
+
+	/* Store at most one batch of what the predecessor published. */
+	if (!merger.received()) {
+	    const unsigned char *span;
+	    const std::size_t span_size = std::min<std::size_t>(in_que->read_span(span), batch_size);
+	    const std::size_t stored = merger.store(span, span_size);
+
+	    in_que->pop(stored);
+	    moved += stored;
+	}
+
+	if (!merger.get_spill()) {
+	    ques_max_size = std::max(ques_max_size, merger.ques_size());
+	}
+
+	/* Merge at most one batch straight into the successor's queue, or print it. */
+	if (out_que != nullptr) {
+	    unsigned char *span;
+	    const std::size_t span_size = std::min<std::size_t>(out_que->write_span(span), batch_size);
+	    const std::size_t merged = merger.merge(span, span_size);
+
+	    out_que->commit(merged);
+	    moved += merged;
+	} else {
+	    const std::size_t merged = merger.merge(out_batch.data(), batch_size);
+
+	    print_numbers(*out, out_batch.data(), merged);
+	    moved += merged;
+	}
+
+	/* Waiting for a neighbour? Let it run if it shares the core. */
+	if (moved == 0) {
+	    sched_yield();
+	}
+    }
+}
+
+/* Pin thread to one core, threads above number of cores share them. */
+void pin_thread(pthread_t thread, unsigned index)
+{
+    const long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    cpu_set_t cpu_set;
+
+    CPU_ZERO(&cpu_set);
+    CPU_SET(index % (cores > 0 ? cores : 1), &cpu_set);
+    pthread_setaffinity_np(thread, sizeof(cpu_set), &cpu_set);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned input_size = 0;
+    unsigned batch_size = DEFAULT_BATCH_SIZE;
+    unsigned fan_in = DEFAULT_FAN_IN;
+    unsigned run_length = DEFAULT_RUN_LENGTH;
+    size_t mem_budget = DEFAULT_MEM_BUDGET;
+    bool echo = true; //print input
+    const char *out_name = NULL; //write sorted numbers to file in binary
+
+    /* Parse options. */
+    int opt;
+    while ((opt = getopt(argc, argv, "b:k:r:m:no:")) != -1) {
+	if (opt == 'b' && (batch_size = std::strtoul(optarg, NULL, 10)) > 0) {
+	    continue;
+	}
+	if (opt == 'k' && (fan_in = std::strtoul(optarg, NULL, 10)) >= 2 && fan_in <= MAX_FAN_IN) {
+	    continue;
+	}
+	if (opt == 'r' && (run_length = std::strtoul(optarg, NULL, 10)) > 0) {
+	    continue;
+	}
+	if (opt == 'm') {
+	    mem_budget = std::strtoull(optarg, NULL, 10);
+	    continue;
+	}
+	if (opt == 'n') {
+	    echo = false;
+	    continue;
+	}
+	if (opt == 'o') {
+	    out_name = optarg;
+	    continue;
+	}
+	std::cerr << "Usage: " << argv[0] << " [-b batch_size] [-k fan_in (2-" << MAX_FAN_IN << ")] [-r run_length] [-m mem_budget] [-n] [-o binary_output]" << std::endl;
+	return EXIT_FAILURE;
+    }
+
+    /*
+     * Input is printed (unless -n) before any stage starts, the last stage
+     * prints sorted numbers as text or writes them to out_name in the same
+     * format as input file.
+     */
+#ifdef NO_OUT
+    echo = false;
+    const OutputSink::Mode out_mode = OutputSink::DISCARD;
+#else
+    const OutputSink::Mode out_mode = out_name ? OutputSink::BINARY : OutputSink::TEXT;
+#endif
+    std::unique_ptr<OutputSink> out;
+    std::unique_ptr<MappedFile> in_file;
+    unsigned char *in_data;
+    try {
+	out.reset(new OutputSink(out_mode, out_name ? out_name : ""));
+	in_file.reset(new MappedFile(FILE_NAME));
+    } catch (std::exception& e) {
+	std::cerr << e.what() << std::endl;
+	return EXIT_FAILURE;
+    }
+    if (in_file->get_size() > std::numeric_limits<unsigned>::max()) {
+	std::cerr << "Error: too many numbers in \"" FILE_NAME "\"." << std::endl;
+	return EXIT_FAILURE;
+    }
+    in_data = in_file->get_data();
+    input_size = in_file->get_size();
+
+    if (echo) {
+	OutputSink echo_out;
+
+	for (size_t i = 0; i < input_size; ++i) {
+	    if (i > 0) {
+		echo_out << ' ';
+	    }
+	    echo_out << static_cast<unsigned>(in_data[i]);
+	}
+	echo_out << '\n';
+    }
+
+    /* Stage i merges sequences of length R*k^(i-1), one thread per stage, as many as pms.cpp needs processors. */
+    unsigned num_stages = 1;
+    for (unsigned long long merged = run_length; merged < input_size; merged *= fan_in) {
+	num_stages++;
+    }
+
+#ifdef MEASURE_TIME
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+#endif
+
+    /* Queue in front of every stage but the root, then the stages themselves. */
+    std::vector<std::unique_ptr<Queue>> ques;
+    std::vector<std::unique_ptr<ThreadStage>> stages;
+    try {
+	for (unsigned i = 1; i < num_stages; ++i) {
+	    ques.emplace_back(new Queue(QUEUE_BATCHES * batch_size));
+	}
+	for (unsigned i = 1; i < num_stages; ++i) {
+	    Queue *out_que = (i + 1 < num_stages) ? ques[i].get() : nullptr;
+
+	    stages.emplace_back(new ThreadStage(i, input_size, batch_size, fan_in, run_length, mem_budget, ques[i - 1].get(), out_que, out.get()));
+	}
+    } catch (std::exception& e) {
+	std::cerr << e.what() << std::endl;
+	return EXIT_FAILURE;
+    }
+
+    std::vector<std::thread> threads;
+    for (unsigned i = 1; i < num_stages; ++i) {
+	ThreadStage *stage = stages[i - 1].get();
+
+	threads.emplace_back([stage]() {
+	    try {
+		stage->run();
+	    } catch (std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		std::exit(EXIT_FAILURE);
+	    }
+	});
+	pin_thread(threads.back().native_handle(), i);
+    }
+    pin_thread(pthread_self(), 0);
+
+    /* The only stage? The only run is sorted allready. */
+    if (num_stages == 1) {
+	sort_run(in_data, input_size);
+	try {
+	    print_numbers(*out, in_data, input_size);
+	} catch (std::exception& e) {
+	    std::cerr << e.what() << std::endl;
+	    return EXIT_FAILURE;
+	}
+    } else {
+	/* Copy numbers to the first stage in batches, sort runs just before their first batch. */
+	Queue &first_que = *ques[0];
+	size_t sorted_cntr = (run_length > 1) ? 0 : input_size;
+	for (size_t i = 0; i < input_size; ) {
+	    unsigned char *span;
+	    const size_t to_send = std::min<size_t>(std::min<size_t>(first_que.write_span(span), batch_size), input_size - i);
+
+	    if (to_send == 0) {
+		sched_yield();
+		continue;
+	    }
+	    while (sorted_cntr < i + to_send) {
+		const size_t run_size = std::min<size_t>(run_length, input_size - sorted_cntr);
+
+		sort_run(in_data + sorted_cntr, run_size);
+		sorted_cntr += run_size;
+	    }
+	    std::copy(in_data + i, in_data + i + to_send, span);
+	    first_que.commit(to_send);
+	    i += to_send;
+	}
+    }
+
+    for (size_t i = 0; i < threads.size(); ++i) {
+	threads[i].join();
+    }
+
+    /* Write the rest of sorted numbers. */
+    try {
+	out->flush();
+    } catch (std::exception& e) {
+	std::cerr << e.what() << std::endl;
+	return EXIT_FAILURE;
+    }
+
+#ifdef MEASURE_TIME
+    const double wall_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    size_t mem = input_size;
+    unsigned spilled = 0;
+
+    for (size_t i = 0; i < stages.size(); ++i) {
+	mem += stages[i]->get_ques_max_size();
+	spilled += stages[i]->get_spill();
+    }
+    std::cout << "walltime: " << std::fixed << wall_time << std::endl;
+    std::cout << "mem: " << mem << std::endl;
+    std::cout << "spilled: " << spilled << std::endl;
+#endif //MEASURE_TIME
+
+    return EXIT_SUCCESS;
+}
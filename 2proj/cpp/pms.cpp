@@ -4,75 +4,179 @@
  */
 
 #include <iostream>
-#include <fstream>
-#include <queue>
+#include <vector>
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
 #include <cerrno>
 #include <ctime>
+#include <memory>
+#include <limits>
+
+#include <unistd.h>
 
 #include <mpi.h>
 
+#include "merger.h"
+#include "mapped_file.h"
+#include "numbers_io.h"
+
 #define FILE_NAME "numbers"
 #define TAG 0
 #define ROOT_PROC 0
+#define DEFAULT_BATCH_SIZE 1024 //elements per message, -b option
+#define DEFAULT_FAN_IN 2 //sequences merged by one stage, -k option
+#define MAX_FAN_IN 16
+#define DEFAULT_RUN_LENGTH 1 //length of runs presorted by root, -r option
+#define SEND_RING_SIZE 4 //number of output batches in flight
+#define DEFAULT_MEM_BUDGET 0 //bytes of ques per stage before spilling to disk, -m option (0 = never)
 
-#ifdef NO_OUT
-#define PRINT(x) do { ; } while (false)
-#else
-#define PRINT(x) do { std::cout << x; } while (false)
+/*
+ * One stage of the pipeline. Receives sequences from the preceding
+ * processor, merges them and sends the result to the succeeding processor
+ * (the last stage prints it instead).
+ */
+class Stage {
+public:
+    /* Constructors. */
+    Stage(int proc_rank, int num_procs, unsigned input_size, unsigned batch_size, unsigned fan_in, unsigned run_length, std::size_t mem_budget, OutputSink *out);
+
+    /* Methods. */
+    void run(void);
+
+    /* Getters. */
+#ifdef MEASURE_TIME
+    std::size_t const& get_ques_max_size() const { return ques_max_size; };
 #endif
+    const double* get_stall() const { return stall; };
+    bool const& get_spill() const { return merger.get_spill(); };
 
-void receive_and_store(const int proc_rank, std::queue<unsigned char>ques[2], const int seq_size, unsigned &received_cntr)
-{
-    static bool store_que_index = 0;
-    unsigned char recv_byte;
+private:
+    void merge_and_send(void);
+    void send_batch(void);
+
+    const int proc_rank, num_procs;
+    const unsigned input_size, batch_size;
+
+    /* Input: receive is posted into one batch while the other is stored. */
+    std::vector<unsigned char> in_batches[2];
+    unsigned received_cntr = 0;
 
-    /* Receive and store data from superior process. */
-    MPI::COMM_WORLD.Recv(&recv_byte, 1, MPI_CHAR, proc_rank - 1, TAG);
-    ques[store_que_index].push(recv_byte);
-    received_cntr++;
+    Merger merger;
 
-    /* Received whole sequence? Switch ques. */
-    if (!(received_cntr % seq_size)) {
-	store_que_index = !store_que_index;
+    /* Output: batches owned by MPI until their Isend completes. */
+    std::vector<unsigned char> out_batches[SEND_RING_SIZE];
+    MPI::Request out_requests[SEND_RING_SIZE];
+    unsigned out_slot = 0; //batch being filled
+    unsigned out_cntr = 0; //elements in the batch being filled
+    OutputSink *out; //sorted sequence of the last stage
+
+#ifdef MEASURE_TIME
+    std::size_t ques_max_size = 0; //in memory, spilled ques are not counted
+#endif
+    double stall[2] = { 0.0, 0.0 }; //waiting for input batch, waiting for free output batch
+};
+
+Stage::Stage(int proc_rank, int num_procs, unsigned input_size, unsigned batch_size, unsigned fan_in, unsigned run_length, std::size_t mem_budget, OutputSink *out):
+	proc_rank(proc_rank), num_procs(num_procs), input_size(input_size), batch_size(batch_size),
+	merger(proc_rank, input_size, batch_size, fan_in, run_length, mem_budget), out(out)
+{
+    in_batches[0].resize(batch_size);
+    in_batches[1].resize(batch_size);
+    for (unsigned i = 0; i < SEND_RING_SIZE; ++i) {
+	out_batches[i].resize(batch_size);
     }
 }
 
-void merge_and_send(const int proc_rank, std::queue<unsigned char>ques[2], const int seq_size, const int num_procs)
+void Stage::run(void)
 {
-    static unsigned que_popped[2] = { 0 };
-    unsigned char to_send;
-    unsigned send_que_index;
-
-    /* One que allready empty for this sequece? Use element from the second one. */
-    if (que_popped[0] == seq_size) {
-	send_que_index = 1;
-    } else if (que_popped[1] == seq_size) {
-	send_que_index = 0;
-
-	/* Both ques available? Compare front elements. */
-    } else if(ques[0].front() <= ques[1].front()) { //possible to switch < to > for reverse order
-	send_que_index = 0;
-    } else {
-	send_que_index = 1;
+    unsigned recv_index = 0; //buffer with receive posted
+
+    /* Keep receive of the next batch posted while merging the previous one. */
+    MPI::Request recv_request;
+    if (input_size > 0) {
+	recv_request = MPI::COMM_WORLD.Irecv(in_batches[recv_index].data(), batch_size, MPI_CHAR, proc_rank - 1, TAG);
     }
 
-    /* Store and remove element from choosen que. */
-    to_send = ques[send_que_index].front();
-    ques[send_que_index].pop();
-    que_popped[send_que_index]++;
+    /* Loop until all data received and processed, AKA until at least one queue is not empty. */
+    while (received_cntr < input_size || !merger.merged()) {
+	/* Receive and store until got all data. */
+	if (received_cntr < input_size) {
+	    MPI::Status status;
+
+	    /* Everything possible is merged, nothing to do until the batch arrives. */
+	    if (!recv_request.Test(status)) {
+		const double stall_start = MPI::Wtime();
+
+		recv_request.Wait(status);
+		stall[0] += MPI::Wtime() - stall_start;
+	    }
+	    const unsigned recv_cnt = status.Get_count(MPI_CHAR);
+	    const unsigned full_index = recv_index;
+
+	    /* Post receive into the other buffer before storing this one. */
+	    recv_index = !recv_index;
+	    received_cntr += recv_cnt;
+	    if (received_cntr < input_size) {
+		recv_request = MPI::COMM_WORLD.Irecv(in_batches[recv_index].data(), batch_size, MPI_CHAR, proc_rank - 1, TAG);
+	    }
+
+	    /* Everything merged before the next receive, there is allways space for one batch. */
+	    if (merger.store(in_batches[full_index].data(), recv_cnt) != recv_cnt) {
+		std::cerr << "Error: no space for received numbers in stage " << proc_rank << "." << std::endl;
+		MPI::COMM_WORLD.Abort(EXIT_FAILURE);
+	    }
+	}
+
+#ifdef MEASURE_TIME
+	if (!merger.get_spill()) {
+	    ques_max_size = std::max(ques_max_size, merger.ques_size());
+	}
+#endif
+
+	/* Merge and send what is possible. */
+	merge_and_send();
+    }
 
-    /* Both ques are fully popped for this sequence? Clear counters. */
-    if (que_popped[0] + que_popped[1] == 2 * seq_size) {
-	que_popped[0] = que_popped[1] = 0;
+    /* Send the last incomplete batch and wait for all batches in flight. */
+    if (out_cntr > 0) {
+	send_batch();
     }
+    MPI::Request::Waitall(SEND_RING_SIZE, out_requests);
+}
 
+void Stage::send_batch(void)
+{
     /* Last processor doesn't send but prints sorted sequence. */
     if (proc_rank < num_procs - 1) {
-	MPI::COMM_WORLD.Send(&to_send, 1, MPI_CHAR, proc_rank + 1, TAG);
+	out_requests[out_slot] = MPI::COMM_WORLD.Isend(out_batches[out_slot].data(), out_cntr, MPI_CHAR, proc_rank + 1, TAG);
+	out_slot = (out_slot + 1) % SEND_RING_SIZE;
+
+	/* Next batch still in flight? Successor can't keep up, wait for it. */
+	if (!out_requests[out_slot].Test()) {
+	    const double stall_start = MPI::Wtime();
+
+	    out_requests[out_slot].Wait();
+	    stall[1] += MPI::Wtime() - stall_start;
+	}
     } else {
-	PRINT(static_cast<unsigned>(to_send) << std::endl);
+	print_numbers(*out, out_batches[out_slot].data(), out_cntr);
+    }
+    out_cntr = 0;
+}
+
+void Stage::merge_and_send(void)
+{
+    /* Merge into the batch being filled, send it whenever it is full. */
+    for (;;) {
+	const std::size_t merged = merger.merge(out_batches[out_slot].data() + out_cntr, batch_size - out_cntr);
+
+	out_cntr += merged;
+	if (out_cntr == batch_size) {
+	    send_batch();
+	} else {
+	    break;
+	}
     }
 }
 
@@ -81,88 +185,209 @@ int main(int argc, char *argv[])
     MPI::Init(argc, argv);
     const int num_procs = MPI::COMM_WORLD.Get_size();
     const int proc_rank = MPI::COMM_WORLD.Get_rank();
-    const unsigned input_size = 1 << (num_procs - 1);
+    unsigned input_size = 0;
+    unsigned batch_size = DEFAULT_BATCH_SIZE;
+    unsigned fan_in = DEFAULT_FAN_IN;
+    unsigned run_length = DEFAULT_RUN_LENGTH;
+    size_t mem_budget = DEFAULT_MEM_BUDGET;
+#ifdef MEASURE_TIME
+    size_t ques_max_size = 0;
+    bool spilled = false; //stage ques were in temporary files
+#endif
+    double stall[2] = { 0.0, 0.0 }; //waiting for input batch, waiting for free output batch
+    bool echo = true; //print input
+    const char *out_name = NULL; //write sorted numbers to file in binary
+
+    /* Parse options. */
+    int opt;
+    while ((opt = getopt(argc, argv, "b:k:r:m:no:")) != -1) {
+	if (opt == 'b' && (batch_size = std::strtoul(optarg, NULL, 10)) > 0) {
+	    continue;
+	}
+	if (opt == 'k' && (fan_in = std::strtoul(optarg, NULL, 10)) >= 2 && fan_in <= MAX_FAN_IN) {
+	    continue;
+	}
+	if (opt == 'r' && (run_length = std::strtoul(optarg, NULL, 10)) > 0) {
+	    continue;
+	}
+	if (opt == 'm') {
+	    mem_budget = std::strtoull(optarg, NULL, 10);
+	    continue;
+	}
+	if (opt == 'n') {
+	    echo = false;
+	    continue;
+	}
+	if (opt == 'o') {
+	    out_name = optarg;
+	    continue;
+	}
+	if (proc_rank == ROOT_PROC) {
+	    std::cerr << "Usage: " << argv[0] << " [-b batch_size] [-k fan_in (2-" << MAX_FAN_IN << ")] [-r run_length] [-m mem_budget] [-n] [-o binary_output]" << std::endl;
+	}
+	MPI::Finalize();
+	return EXIT_FAILURE;
+    }
+
+    /*
+     * Root prints input (unless -n), the last processor prints sorted numbers
+     * as text or writes them to out_name in the same format as input file.
+     */
+#ifdef NO_OUT
+    echo = false;
+    const OutputSink::Mode out_mode = OutputSink::DISCARD;
+#else
+    const OutputSink::Mode out_mode = out_name ? OutputSink::BINARY : OutputSink::TEXT;
+#endif
+    std::unique_ptr<OutputSink> out;
+    if (proc_rank == num_procs - 1) {
+	try {
+	    out.reset(new OutputSink(out_mode, out_name ? out_name : ""));
+	} catch (std::exception& e) {
+	    std::cerr << e.what() << std::endl;
+	    MPI::COMM_WORLD.Abort(EXIT_FAILURE);
+	}
+    }
 
 #ifdef MEASURE_TIME
-    size_t reduced_mem, ques_max_size = 0;
-    double wall_time, to_reduce_time, reduced_time;
-    clock_t cpu_time;
+    size_t reduced_mem;
+    double wall_time = 0.0, to_reduce_time, reduced_time;
+    clock_t cpu_time = 0;
 
     MPI::COMM_WORLD.Barrier();
 #endif //MEASURE_TIME
 
     /* 
-     * First processor reads input and sends it to the second processor.
-     * Every other processor receives and stores data, merges and sends
-     * merged sequence to the succeding processor. The last processor
-     * doesn't send anything but prints sorted sequence.
+     * First processor reads input, sorts runs of run_length numbers and sends
+     * them to the second processor. Every other processor receives and stores
+     * data, merges and sends merged sequence to the succeding processor. The
+     * last processor doesn't send anything but prints sorted sequence.
      */
+    std::unique_ptr<MappedFile> in_file;
+    unsigned char *in_data = nullptr;
     if (proc_rank == ROOT_PROC) {
-	std::queue<unsigned char> in_que;
-
-	/* Open file and check for errors. */
-	std::ifstream is(FILE_NAME, std::ifstream::in | std::ifstream::binary);
-	if (is) {
-	    unsigned char read_byte;
-	    bool first = true;
-
-	    /* Read byte after byte, print it and store it in queue. */
-	    while (is.read(reinterpret_cast<char*>(&read_byte), 1)) {
-		if (first) {
-		    first = false;
-		} else {
-		    PRINT(' ');
+	/*
+	 * Map the file instead of reading it, its pages are read in as they are
+	 * sent, so the pipeline is working while the rest of the file is still
+	 * being read.
+	 */
+	try {
+	    in_file.reset(new MappedFile(FILE_NAME));
+	} catch (std::exception& e) {
+	    std::cerr << e.what() << std::endl;
+	    MPI::COMM_WORLD.Abort(EXIT_FAILURE);
+	}
+	if (in_file->get_size() > std::numeric_limits<unsigned>::max()) {
+	    std::cerr << "Error: too many numbers in \"" FILE_NAME "\"." << std::endl;
+	    MPI::COMM_WORLD.Abort(EXIT_FAILURE);
+	}
+	in_data = in_file->get_data();
+	input_size = in_file->get_size();
+
+	/* Print input before the last processor starts printing (reads whole file). */
+	if (echo) {
+	    OutputSink echo_out;
+
+	    for (size_t i = 0; i < input_size; ++i) {
+		if (i > 0) {
+		    echo_out << ' ';
 		}
-		PRINT(static_cast<unsigned>(read_byte));
-		in_que.push(read_byte);
+		echo_out << static_cast<unsigned>(in_data[i]);
 	    }
-	    PRINT(std::endl);
+	    echo_out << '\n';
+	}
+    }
 
-	    /* Check for errors during file reading. */
-	    if (!is.eof()) {
-		std::cerr << strerror(errno) << " \"" FILE_NAME "\"" << std::endl;
-		MPI::COMM_WORLD.Abort(errno);
-	    }
-	    is.close();
-	} else {
-	    std::cerr << strerror(errno) << " \"" FILE_NAME "\"" << std::endl;
-	    MPI::COMM_WORLD.Abort(errno);
+    /*
+     * Every stage needs the input size to know the length of the last
+     * (shorter) sequence. Processor i merges sequences of length R*k^(i-1),
+     * so N numbers need at least ceil(log_k(N/R)) + 1 processors. Presorted
+     * runs of length R = k^j replace the first j stages.
+     */
+    MPI::COMM_WORLD.Bcast(&input_size, 1, MPI_UNSIGNED, ROOT_PROC);
+    int procs_needed = 1;
+    for (unsigned long long merged = run_length; merged < input_size; merged *= fan_in) {
+	procs_needed++;
+    }
+    if (num_procs < procs_needed) {
+	if (proc_rank == ROOT_PROC) {
+	    std::cerr << "Error: " << input_size << " numbers need at least " << procs_needed << " processors." << std::endl;
 	}
+	MPI::Finalize();
+	return EXIT_FAILURE;
+    }
 
+    if (proc_rank == ROOT_PROC) {
 #ifdef MEASURE_TIME
 	wall_time = MPI::Wtime();
 	cpu_time = clock();
 #endif
-	/* Send each number from the queue to the first processor. */
-	while (!in_que.empty()) {
-	    unsigned to_send = in_que.front();
+	/* The only processor? The only run is sorted allready. */
+	if (num_procs == 1) {
+	    sort_run(in_data, input_size);
+	    try {
+		print_numbers(*out, in_data, input_size);
+	    } catch (std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		MPI::COMM_WORLD.Abort(EXIT_FAILURE);
+	    }
+	} else {
+	    /*
+	     * Send numbers to the first processor in batches, SEND_RING_SIZE of
+	     * them in flight. Runs are sorted just before their first batch is
+	     * sent, not all of them in advance.
+	     */
+	    MPI::Request requests[SEND_RING_SIZE];
+	    size_t sorted_cntr = (run_length > 1) ? 0 : input_size;
+	    for (size_t i = 0, slot = 0; i < input_size; i += batch_size, slot = (slot + 1) % SEND_RING_SIZE) {
+		const size_t to_send = std::min<size_t>(batch_size, input_size - i);
 
-	    in_que.pop();
-	    MPI::COMM_WORLD.Send(&to_send, 1, MPI_CHAR, proc_rank + 1, TAG);
+		while (sorted_cntr < i + to_send) {
+		    const size_t run_size = std::min<size_t>(run_length, input_size - sorted_cntr);
+
+		    sort_run(in_data + sorted_cntr, run_size);
+		    sorted_cntr += run_size;
+		}
+
+		if (!requests[slot].Test()) {
+		    const double stall_start = MPI::Wtime();
+
+		    requests[slot].Wait();
+		    stall[1] += MPI::Wtime() - stall_start;
+		}
+		requests[slot] = MPI::COMM_WORLD.Isend(in_data + i, to_send, MPI_CHAR, proc_rank + 1, TAG);
+	    }
+	    MPI::Request::Waitall(SEND_RING_SIZE, requests);
 	}
     } else {
-	const unsigned seq_size = 1 << (proc_rank - 1);
-	unsigned received_cntr = 0;
-
-	std::queue<unsigned char> ques[2];
+	try {
+	    Stage stage(proc_rank, num_procs, input_size, batch_size, fan_in, run_length, mem_budget, out.get());
 
 #ifdef MEASURE_TIME
-	cpu_time = clock();
+	    cpu_time = clock();
 #endif
-	/* Loop until all data processed, AKA until at least one queue is not empty. */
-	do {
-	    /* Receive and store until got all data. */
-	    if (received_cntr < input_size) {
-		receive_and_store(proc_rank, ques, seq_size, received_cntr);
-	    }
+	    stage.run();
 
-	    ques_max_size = std::max(ques_max_size, ques[0].size() + ques[1].size());
+#ifdef MEASURE_TIME
+	    ques_max_size = stage.get_ques_max_size();
+	    spilled = stage.get_spill();
+#endif
+	    stall[0] = stage.get_stall()[0];
+	    stall[1] = stage.get_stall()[1];
+	} catch (std::exception& e) {
+	    std::cerr << e.what() << std::endl;
+	    MPI::COMM_WORLD.Abort(EXIT_FAILURE);
+	}
+    }
 
-	    /* Merge and send until all data processed. */
-	    if (received_cntr > seq_size) {
-		merge_and_send(proc_rank, ques, seq_size, num_procs);
-	    }
-	} while (!(ques[0].empty() && ques[1].empty()));
+    /* Write the rest of sorted numbers. */
+    if (out) {
+	try {
+	    out->flush();
+	} catch (std::exception& e) {
+	    std::cerr << e.what() << std::endl;
+	    MPI::COMM_WORLD.Abort(EXIT_FAILURE);
+	}
     }
 
 #ifdef MEASURE_TIME
@@ -174,11 +399,21 @@ int main(int argc, char *argv[])
     to_reduce_time = static_cast<double>(cpu_time) / CLOCKS_PER_SEC;
     MPI::COMM_WORLD.Reduce(&to_reduce_time, &reduced_time, 1, MPI_DOUBLE, MPI_SUM, ROOT_PROC);
     MPI::COMM_WORLD.Reduce(&ques_max_size, &reduced_mem, 1, MPI_UNSIGNED_LONG, MPI_SUM, ROOT_PROC);
+    int to_reduce_spilled = spilled, reduced_spilled;
+    MPI::COMM_WORLD.Reduce(&to_reduce_spilled, &reduced_spilled, 1, MPI_INT, MPI_SUM, ROOT_PROC);
+
+    /* Stall times of all stages: waiting for predecessor and for successor. */
+    std::vector<double> stalls(proc_rank == ROOT_PROC ? 2 * num_procs : 0);
+    MPI::COMM_WORLD.Gather(stall, 2, MPI_DOUBLE, stalls.data(), 2, MPI_DOUBLE, ROOT_PROC);
 
     if (proc_rank == ROOT_PROC) {
 	std::cout << "walltime: " << std::fixed << wall_time << std::endl;
 	std::cout << "reduced: " << std::fixed << reduced_time << std::endl;
 	std::cout << "mem: " << std::fixed << reduced_mem + input_size << std::endl;
+	std::cout << "spilled: " << reduced_spilled << std::endl;
+	for (int i = 0; i < num_procs; ++i) {
+	    std::cout << "stall " << i << ": " << std::fixed << stalls[2 * i] << ' ' << stalls[2 * i + 1] << std::endl;
+	}
     }
 #endif //MEASURE_TIME
 
@@ -0,0 +1,136 @@
+/*
+ * author: Jan Wrona
+ * email: <xwrona00@stud.fit.vutbr.cz>
+ *
+ * Fixed-capacity FIFO ring buffer. Capacity is rounded up to a power of two,
+ * so head and tail are free running counters and index is just masked. Whole
+ * buffer is allocated once in constructor, push and pop never allocate.
+ * Bulk operations work over contiguous spans, every span may wrap around
+ * the end of storage at most once.
+ *
+ * Storage of a spilled buffer is a mapped temporary file instead of heap
+ * memory, so it may be larger than RAM (T has to be trivially copyable).
+ */
+
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <vector> /* std::vector */
+#include <algorithm> /* std::min, std::copy */
+#include <cstddef> /* std::size_t */
+#include <memory> /* std::unique_ptr */
+
+#include "mapped_file.h"
+
+template <typename T>
+class RingBuffer {
+public:
+    /* Constructors. */
+    RingBuffer(std::size_t min_capacity, bool spill = false);
+
+    /* Single element methods. */
+    void push(const T &elem) { data[tail++ & mask] = elem; };
+    void pop(std::size_t count = 1) { head += count; };
+    T const& front() const { return data[head & mask]; };
+
+    /* Bulk methods, return number of elements really copied. */
+    std::size_t push(const T *src, std::size_t count);
+    std::size_t pop(T *dst, std::size_t count);
+
+    /*
+     * Contiguous spans for zero-copy use. read_span() points to the first
+     * stored elements, consume them with pop(count). write_span() points to
+     * the first free place, fill it and publish it with commit(count).
+     */
+    std::size_t read_span(const T *&span) const;
+    std::size_t write_span(T *&span);
+    void commit(std::size_t count) { tail += count; };
+
+    /* Getters. */
+    std::size_t size() const { return tail - head; };
+    std::size_t capacity() const { return mask + 1; };
+    bool empty() const { return head == tail; };
+    bool full() const { return size() == capacity(); };
+    bool spilled() const { return static_cast<bool>(spill_file); };
+
+private:
+    T *data;
+    std::vector<T> heap; //storage in memory
+    std::unique_ptr<TempMapping> spill_file; //or in temporary file
+    std::size_t mask;
+    std::size_t head = 0, tail = 0; //free running, index is masked
+};
+
+template <typename T>
+RingBuffer<T>::RingBuffer(std::size_t min_capacity, bool spill)
+{
+    std::size_t capacity = 1;
+
+    while (capacity < min_capacity) {
+	capacity <<= 1;
+    }
+    if (spill) {
+	spill_file.reset(new TempMapping(capacity * sizeof(T)));
+	data = static_cast<T *>(spill_file->get_data());
+    } else {
+	heap.resize(capacity);
+	data = heap.data();
+    }
+    mask = capacity - 1;
+}
+
+template <typename T>
+std::size_t RingBuffer<T>::read_span(const T *&span) const
+{
+    const std::size_t index = head & mask;
+
+    span = data + index;
+    return std::min(size(), capacity() - index);
+}
+
+template <typename T>
+std::size_t RingBuffer<T>::write_span(T *&span)
+{
+    const std::size_t index = tail & mask;
+
+    span = data + index;
+    return std::min(capacity() - size(), capacity() - index);
+}
+
+template <typename T>
+std::size_t RingBuffer<T>::push(const T *src, std::size_t count)
+{
+    std::size_t pushed = 0;
+
+    /* At most two spans: up to the end of storage and from its beginning. */
+    for (int i = 0; i < 2 && pushed < count; ++i) {
+	T *span;
+	const std::size_t span_size = std::min(write_span(span), count - pushed);
+
+	std::copy(src + pushed, src + pushed + span_size, span);
+	commit(span_size);
+	pushed += span_size;
+    }
+
+    return pushed;
+}
+
+template <typename T>
+std::size_t RingBuffer<T>::pop(T *dst, std::size_t count)
+{
+    std::size_t popped = 0;
+
+    /* At most two spans: up to the end of storage and from its beginning. */
+    for (int i = 0; i < 2 && popped < count; ++i) {
+	const T *span;
+	const std::size_t span_size = std::min(read_span(span), count - popped);
+
+	std::copy(span, span + span_size, dst + popped);
+	pop(span_size);
+	popped += span_size;
+    }
+
+    return popped;
+}
+
+#endif //RING_BUFFER_H
@@ -0,0 +1,102 @@
+/*
+ * author: Jan Wrona
+ * email: <xwrona00@stud.fit.vutbr.cz>
+ *
+ * Lock-free single-producer/single-consumer FIFO between two threads. Same
+ * masked power-of-two storage as RingBuffer, but head (owned by consumer)
+ * and tail (owned by producer) are atomic and each lives on its own cache
+ * line together with the owner's cached copy of the other counter, so the
+ * line of the other side is touched only when the cached copy limits the
+ * span being asked for. Numbers are handed over in spans: fill write_span()
+ * and publish it by commit(), read read_span() and release it by pop().
+ */
+
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <vector> /* std::vector */
+#include <atomic> /* std::atomic */
+#include <algorithm> /* std::min */
+#include <cstddef> /* std::size_t */
+
+#define CACHE_LINE_SIZE 64
+
+/* Queues are allocated by new, which aligns to CACHE_LINE_SIZE since C++17. */
+#if __cplusplus < 201703L
+#error "SpscQueue requires C++17 (aligned new)"
+#endif
+
+template <typename T>
+class SpscQueue {
+public:
+    /* Constructors. */
+    SpscQueue(std::size_t min_capacity);
+
+    /* Producer methods. */
+    std::size_t write_span(T *&span);
+    void commit(std::size_t count) { tail.store(tail.load(std::memory_order_relaxed) + count, std::memory_order_release); };
+
+    /* Consumer methods. */
+    std::size_t read_span(const T *&span);
+    void pop(std::size_t count) { head.store(head.load(std::memory_order_relaxed) + count, std::memory_order_release); };
+
+    /* Getters. */
+    std::size_t capacity() const { return mask + 1; };
+
+private:
+    SpscQueue(const SpscQueue&); //not copyable, shared by two threads
+    SpscQueue& operator=(const SpscQueue&);
+
+    std::vector<T> data;
+    std::size_t mask;
+
+    /* Consumer's line. */
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> head{0}; //free running, index is masked
+    std::size_t cached_tail = 0;
+
+    /* Producer's line. */
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> tail{0};
+    std::size_t cached_head = 0;
+};
+
+template <typename T>
+SpscQueue<T>::SpscQueue(std::size_t min_capacity)
+{
+    std::size_t capacity = 1;
+
+    while (capacity < min_capacity) {
+	capacity <<= 1;
+    }
+    data.resize(capacity);
+    mask = capacity - 1;
+}
+
+/* Contiguous free space, may be shorter than all free space when it wraps. */
+template <typename T>
+std::size_t SpscQueue<T>::write_span(T *&span)
+{
+    const std::size_t my_tail = tail.load(std::memory_order_relaxed);
+    const std::size_t index = my_tail & mask;
+
+    if (capacity() - (my_tail - cached_head) < capacity() - index) {
+	cached_head = head.load(std::memory_order_acquire);
+    }
+    span = data.data() + index;
+    return std::min(capacity() - (my_tail - cached_head), capacity() - index);
+}
+
+/* Contiguous published elements, may be fewer than all of them when they wrap. */
+template <typename T>
+std::size_t SpscQueue<T>::read_span(const T *&span)
+{
+    const std::size_t my_head = head.load(std::memory_order_relaxed);
+    const std::size_t index = my_head & mask;
+
+    if (cached_tail - my_head < capacity() - index) {
+	cached_tail = tail.load(std::memory_order_acquire);
+    }
+    span = data.data() + index;
+    return std::min(cached_tail - my_head, capacity() - index);
+}
+
+#endif //SPSC_QUEUE_H
@@ -2,7 +2,7 @@
 #author: Jan Wrona
 #email: xwrona00@stud.fit.vutbr.cz
 
-USAGE="Usage: ${0} problem_size"
+USAGE="Usage: ${0} problem_size [batch_size [fan_in [run_length [mem_budget]]]]"
 MPIPATH="/usr/local/share/OpenMPI/bin/"
 NAME="pms"
 
@@ -13,17 +13,48 @@ then
     exit 1
 fi
 
-PS=`echo "${1}" | bc` #exp to int
-PS="${PS%.*}" #remove floating point
-LOG_FLOAT=`echo "l(${PS})/l(2)" | bc -l`
-LOG="${LOG_FLOAT%.*}"
+#batch_size is number of elements sent in one message (default in source)
+if [[ -n $2 && ! $2 =~ ^[1-9][0-9]*$ ]]
+then
+    echo "${USAGE}"
+    exit 1
+fi
 
-#check if problem_size was power of two
-if [ ${PS} -ne `echo "2^${LOG}" | bc` ]
+#fan_in is number of sequences merged by one stage (2 to 16)
+if [[ -n $3 && ! $3 =~ ^([2-9]|1[0-6])$ ]]
 then
-    echo "Error: problem size has to be a power of two."
+    echo "${USAGE}"
     exit 1
 fi
+FAN_IN="${3:-2}"
+
+#run_length is length of runs presorted by the first processor
+if [[ -n $4 && ! $4 =~ ^[1-9][0-9]*$ ]]
+then
+    echo "${USAGE}"
+    exit 1
+fi
+RUN_LENGTH="${4:-1}"
+
+#mem_budget is number of bytes of ques per stage, bigger stages spill to disk
+if [[ -n $5 && ! $5 =~ ^[0-9]+$ ]]
+then
+    echo "${USAGE}"
+    exit 1
+fi
+MEM_BUDGET="${5:-0}"
+
+PS=`echo "${1}" | bc` #exp to int
+PS="${PS%.*}" #remove floating point
+
+#ceil(log_fan_in(problem_size / run_length)), the last sequence may be shorter
+LOG=0
+MERGED=${RUN_LENGTH}
+while [ ${MERGED} -lt ${PS} ]
+do
+    LOG=$((LOG+1))
+    MERGED=$((MERGED*FAN_IN))
+done
 
 CPUS=$((LOG+1))
 
@@ -37,7 +68,7 @@ dd if=/dev/urandom bs=1 count="${PS}" of=numbers 2> /dev/null
 "${MPIPATH}mpic++" -Ofast -DNO_OUT -DMEASURE_TIME -o "${NAME}" "${NAME}.cpp"
 
 #run
-"${MPIPATH}mpirun" -np "${CPUS}" "${NAME}" #> sorted_pms.txt
+"${MPIPATH}mpirun" -np "${CPUS}" "${NAME}" ${2:+-b "${2}"} -k "${FAN_IN}" -r "${RUN_LENGTH}" -m "${MEM_BUDGET}" #> sorted_pms.txt
 
 #cmp sorted_{sort,pms}.txt
 
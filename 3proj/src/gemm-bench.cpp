@@ -0,0 +1,118 @@
+/*
+ * author: Jan Wrona
+ * email: <xwrona00@stud.fit.vutbr.cz>
+ *
+ * Micro-benchmark of the local matrix multiplication kernel (multiply_add()
+ * in mm.h) against the naive i-j-k loop of former Matrix<T>::operator*. For
+ * square int -> long, float and double matrices prints GOP/s of both
+ * (2 * n^3 operations, best of runs) and checks that results match.
+ *
+ * compilation: g++ -std=c++11 -O3 -march=native -pthread -o gemm-bench gemm-bench.cpp
+ * usage: gemm-bench [n [runs]]
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+
+#include "mm.h"
+
+#define DEFAULT_SIZE 512
+#define DEFAULT_RUNS 3
+
+/* Naive i-j-k loop, multiplier walked with stride n, results appended. */
+template <typename S, typename R>
+std::vector<R> naive_multiply(std::size_t n, const std::vector<S> &a, const std::vector<S> &b)
+{
+    std::vector<R> c;
+
+    for (std::size_t i = 0; i < n; ++i) {
+	for (std::size_t j = 0; j < n; ++j) {
+	    R product = 0;
+
+	    for (std::size_t k = 0; k < n; ++k) {
+		product += static_cast<R>(a[i * n + k]) * b[k * n + j];
+	    }
+	    c.push_back(product);
+	}
+    }
+
+    return c;
+}
+
+/* Best time of runs calls of f in seconds. */
+template <typename F>
+double best_time(unsigned runs, F f)
+{
+    double best = 0.0;
+
+    for (unsigned run = 0; run < runs; ++run) {
+	const auto start = std::chrono::steady_clock::now();
+	f();
+	const std::chrono::duration<double> diff = std::chrono::steady_clock::now() - start;
+
+	if (run == 0 || diff.count() < best) {
+	    best = diff.count();
+	}
+    }
+
+    return best;
+}
+
+template <typename S, typename R>
+void bench(const char *name, std::size_t n, unsigned runs, S min, S max, double tolerance)
+{
+    std::mt19937 gen(n);
+    std::uniform_real_distribution<double> dist(min, max);
+    std::vector<S> a(n * n), b(n * n);
+    std::vector<R> naive, tuned;
+
+    for (std::size_t i = 0; i < n * n; ++i) {
+	a[i] = static_cast<S>(dist(gen));
+	b[i] = static_cast<S>(dist(gen));
+    }
+
+    const double naive_time = best_time(runs, [&]() { naive = naive_multiply<S, R>(n, a, b); });
+    const double tuned_time = best_time(runs, [&]() {
+	tuned.assign(n * n, R());
+	multiply_add(n, n, n, a.data(), n, b.data(), n, tuned.data(), n);
+    });
+
+    /* Summation order differs, floating point results may differ a bit. */
+    bool match = true;
+    for (std::size_t i = 0; i < n * n; ++i) {
+	if (std::abs(static_cast<double>(naive[i]) - static_cast<double>(tuned[i])) >
+		tolerance * std::max(1.0, std::abs(static_cast<double>(naive[i])))) {
+	    match = false;
+	    break;
+	}
+    }
+
+    const double ops = 2.0 * n * n * n;
+    std::cout << std::left << std::setw(12) << name << std::right << std::fixed << std::setprecision(2)
+	<< std::setw(10) << ops / naive_time * 1e-9 << std::setw(10) << ops / tuned_time * 1e-9
+	<< std::setw(9) << naive_time / tuned_time << "x" << (match ? "" : "  MISMATCH") << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    const std::size_t n = (argc > 1) ? std::strtoul(argv[1], NULL, 10) : DEFAULT_SIZE;
+    const unsigned runs = (argc > 2) ? std::strtoul(argv[2], NULL, 10) : DEFAULT_RUNS;
+
+    if (n == 0 || runs == 0) {
+	std::cerr << "Usage: " << argv[0] << " [n [runs]]" << std::endl;
+	return EXIT_FAILURE;
+    }
+
+    std::cout << "n = " << n << ", GOP/s (2 * n^3 operations)" << std::endl;
+    std::cout << "type           naive     tuned  speedup" << std::endl;
+    bench<int, long>("int->long", n, runs, -2147483648.0, 2147483647.0, 0.0);
+    bench<float, float>("float", n, runs, -1.0f, 1.0f, 1e-3);
+    bench<double, double>("double", n, runs, -1.0, 1.0, 1e-9);
+
+    return EXIT_SUCCESS;
+}
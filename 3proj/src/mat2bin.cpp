@@ -0,0 +1,38 @@
+/*
+ * author: Jan Wrona
+ * email: <xwrona00@stud.fit.vutbr.cz>
+ *
+ * Converts matrix from text format (mat1 or mat2) into binary format (see
+ * MatrixHeader in mm.h) read by mm -f. Elements are int, the same as src_t
+ * of mm.cpp.
+ *
+ * compilation: g++ -std=c++11 -O2 -pthread -o mat2bin mat2bin.cpp
+ * usage: mat2bin multiplicand|multiplier text_file binary_file
+ */
+
+#include <iostream>
+#include <string>
+#include <cstdlib>
+
+#include "mm.h"
+
+int main(int argc, char *argv[])
+{
+    if (argc != 4 || (std::string(argv[1]) != "multiplicand" && std::string(argv[1]) != "multiplier")) {
+	std::cerr << "Usage: " << argv[0] << " multiplicand|multiplier text_file binary_file" << std::endl;
+	return EXIT_FAILURE;
+    }
+
+    /* Type decides meaning of the first line of text file. */
+    Matrix<int> matrix(std::string(argv[1]) == "multiplicand" ? Matrix<int>::MULTIPLICAND :
+	    Matrix<int>::MULTIPLIER);
+    try {
+	matrix.load(argv[2]);
+	matrix.save(argv[3]);
+    } catch (std::exception& e) {
+	std::cerr << e.what() << std::endl;
+	return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
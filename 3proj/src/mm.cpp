@@ -12,6 +12,9 @@
 #include <stdexcept>
 #include <bitset>
 #include <chrono>
+#include <algorithm>
+
+#include <unistd.h>
 
 #include "mm.h"
 
@@ -19,6 +22,9 @@
 #define ROOT_PROC 0
 #define MULTIPLICAND_FILE_NAME "mat1"
 #define MULTIPLIER_FILE_NAME "mat2"
+#define MULTIPLICAND_BIN_FILE_NAME "mat1.bin" //binary format, -f option
+#define MULTIPLIER_BIN_FILE_NAME "mat2.bin"
+#define DEFAULT_CHUNK_SIZE 256 //operands of systolic mesh in one message, -c option
 
 //#define MEASURE_TIME
 
@@ -36,34 +42,58 @@ enum {
     PROC_ROLES_COUNT
 };
 
-int main(int argc, char *argv[])
+/* Size of i-th of parts blocks of dim, the first dim % parts blocks are one longer. */
+std::size_t block_size(std::size_t dim, std::size_t parts, std::size_t i)
 {
-    MPI::Init(argc, argv);
-    const int world_procs = MPI::COMM_WORLD.Get_size();
-    const int world_rank = MPI::COMM_WORLD.Get_rank();
-    std::size_t shared_dim, prod_rows, prod_cols;
+    return dim / parts + (i < dim % parts);
+}
 
-    /* Load both matrices by root processor. */
-    Matrix<src_t> multiplicand(Matrix<src_t>::MULTIPLICAND);
-    Matrix<src_t> multiplier(Matrix<src_t>::MULTIPLIER);
-    if (world_rank == ROOT_PROC) {
-	try {
-	    multiplicand.load(MULTIPLICAND_FILE_NAME);
-	    multiplier.load(MULTIPLIER_FILE_NAME);
-	} catch (std::exception& e) {
-	    std::cerr << e.what() << std::endl;
-	    MPI::COMM_WORLD.Abort(EXIT_FAILURE);
-	}
+/* Offset of i-th of parts blocks of dim. */
+std::size_t block_offset(std::size_t dim, std::size_t parts, std::size_t i)
+{
+    return i * (dim / parts) + std::min(i, dim % parts);
+}
 
-	prod_rows = multiplicand.get_rows();
-	prod_cols = multiplier.get_cols();
-	shared_dim = multiplicand.get_cols();
+/* Index of block of dim containing index, empty blocks are skipped. */
+std::size_t block_owner(std::size_t dim, std::size_t parts, std::size_t index)
+{
+    std::size_t i = 0;
+
+    while (block_offset(dim, parts, i) + block_size(dim, parts, i) <= index) {
+	i++;
     }
+    return i;
+}
 
-    /* Distribute dimensions among all processors. */
-    MPI::COMM_WORLD.Bcast(&prod_rows, 1, MPI::UNSIGNED_LONG, ROOT_PROC);
-    MPI::COMM_WORLD.Bcast(&prod_cols, 1, MPI::UNSIGNED_LONG, ROOT_PROC);
-    MPI::COMM_WORLD.Bcast(&shared_dim, 1, MPI::UNSIGNED_LONG, ROOT_PROC);
+/*
+ * Collectively read count blocks of block_len elements, stride elements
+ * apart, starting by element offset of binary matrix file. File view makes
+ * every processor of comm read only its part straight into buf.
+ */
+void read_blocks(const MPI::Intracomm& comm, const char *file_name, std::size_t offset,
+	std::size_t count, std::size_t block_len, std::size_t stride, src_t *buf)
+{
+    auto file_t = MPI_SRC_T.Create_vector(count, block_len, stride);
+    file_t.Commit();
+
+    auto file = MPI::File::Open(comm, file_name, MPI::MODE_RDONLY, MPI::INFO_NULL);
+    file.Set_view(sizeof(MatrixHeader) + offset * sizeof(src_t), MPI_SRC_T, file_t, "native",
+	    MPI::INFO_NULL);
+    file.Read_all(buf, count * block_len, MPI_SRC_T);
+    file.Close();
+    file_t.Free();
+}
+
+/*
+ * Systolic mesh, one processor for each product element. Multiplicand rows
+ * enter from the left, multiplier columns from the top and both flow through
+ * the mesh in chunks of chunk_size numbers. Product has as many rows as
+ * there are processors in one mesh column.
+ */
+void systolic_multiply(const Matrix<src_t>& multiplicand, const Matrix<src_t>& multiplier,
+	std::size_t prod_cols, std::size_t shared_dim, std::size_t chunk_size, bool binary)
+{
+    const int world_rank = MPI::COMM_WORLD.Get_rank();
 
     /* Create intra row and intra column comunicators. */
     auto row_comm = MPI::COMM_WORLD.Split(world_rank / prod_cols, world_rank % prod_cols);
@@ -86,8 +116,13 @@ int main(int argc, char *argv[])
 	multiplicand_rows.reserve(shared_dim); //avoid future reallocations
 	multiplicand_rows.resize(shared_dim); //set correct vector size
 
-	col_comm.Scatter(multiplicand.get_data(), shared_dim, MPI_SRC_T,
-		multiplicand_rows.data(), shared_dim, MPI_SRC_T, ROOT_PROC);
+	if (binary) {
+	    read_blocks(col_comm, MULTIPLICAND_BIN_FILE_NAME, col_rank * shared_dim, 1,
+		    shared_dim, shared_dim, multiplicand_rows.data());
+	} else {
+	    col_comm.Scatter(multiplicand.get_data(), shared_dim, MPI_SRC_T,
+		    multiplicand_rows.data(), shared_dim, MPI_SRC_T, ROOT_PROC);
+	}
     }
 
     /* Distribute multiplier columns among processors in the first row. */
@@ -96,14 +131,19 @@ int main(int argc, char *argv[])
 	multiplier_cols.reserve(shared_dim); //avoid future reallocations
 	multiplier_cols.resize(shared_dim); //set correct vector size
 
-	/* Create column data type. */
-	auto mpi_column_t = MPI_SRC_T.Create_vector(shared_dim, 1, prod_cols);
-	mpi_column_t.Commit();
-	mpi_column_t = mpi_column_t.Create_resized(0, sizeof(src_t));
-	mpi_column_t.Commit();
+	if (binary) {
+	    read_blocks(row_comm, MULTIPLIER_BIN_FILE_NAME, row_rank, shared_dim, 1,
+		    prod_cols, multiplier_cols.data());
+	} else {
+	    /* Create column data type. */
+	    auto mpi_column_t = MPI_SRC_T.Create_vector(shared_dim, 1, prod_cols);
+	    mpi_column_t.Commit();
+	    mpi_column_t = mpi_column_t.Create_resized(0, sizeof(src_t));
+	    mpi_column_t.Commit();
 
-	row_comm.Scatter(multiplier.get_data(), 1, mpi_column_t,
-		multiplier_cols.data(), shared_dim, MPI_SRC_T, ROOT_PROC);
+	    row_comm.Scatter(multiplier.get_data(), 1, mpi_column_t,
+		    multiplier_cols.data(), shared_dim, MPI_SRC_T, ROOT_PROC);
+	}
     }
 
 #ifdef MEASURE_TIME
@@ -114,44 +154,95 @@ int main(int argc, char *argv[])
     res_t acc_res = 0;
     bool overflow_detected = false;
 
-    /* For each element do actions based on processor position. */
-    for (std::size_t i = 0; i < shared_dim; ++i) {
-	src_t left, upper;
-	res_t res;
+    /*
+     * Operands flow through the mesh in chunks of chunk_size elements. Two
+     * buffers per direction: while one chunk is multiplied, the next one is
+     * being received into the other buffer. Buffer is reused for receiving
+     * only after the chunk previously sent from it has left.
+     */
+    const std::size_t chunks = (shared_dim + chunk_size - 1) / chunk_size;
+    std::vector<src_t> left_bufs[2], upper_bufs[2];
+    MPI::Request left_recv[2], upper_recv[2], left_send[2], upper_send[2];
+
+    /* Receive chunk i into its buffer (operands from memory need no buffer). */
+    auto post_recv = [&](std::size_t i) {
+	const unsigned buf = i % 2;
+	const std::size_t offset = i * chunk_size;
+	const int count = std::min(chunk_size, shared_dim - offset);
+
+	if (!proc_pos[FIRST_COL]) {
+	    if (left_send[buf] != MPI::REQUEST_NULL) {
+		left_send[buf].Wait();
+	    }
+	    left_bufs[buf].resize(chunk_size);
+	    left_recv[buf] = row_comm.Irecv(left_bufs[buf].data(), count, MPI_SRC_T, row_rank - 1, TAG);
+	}
+	if (!proc_pos[FIRST_ROW]) {
+	    if (upper_send[buf] != MPI::REQUEST_NULL) {
+		upper_send[buf].Wait();
+	    }
+	    upper_bufs[buf].resize(chunk_size);
+	    upper_recv[buf] = col_comm.Irecv(upper_bufs[buf].data(), count, MPI_SRC_T, col_rank - 1, TAG);
+	}
+    };
+
+    if (chunks > 0) {
+	post_recv(0);
+    }
+
+    /* For each chunk do actions based on processor position. */
+    for (std::size_t i = 0; i < chunks; ++i) {
+	const unsigned buf = i % 2;
+	const std::size_t offset = i * chunk_size;
+	const int count = std::min(chunk_size, shared_dim - offset);
+	const src_t *left, *upper;
 
 	/* Processors in first column/row will read multiplicand/multiplier
 	 * from memory, processors in other columns/rows will receive
 	 * multiplicand/multiplier in message.
 	 */
 	if (proc_pos[FIRST_COL]) {
-	    left = multiplicand_rows.back();
-	    multiplicand_rows.pop_back();
+	    left = multiplicand_rows.data() + offset;
 	} else {
-	    row_comm.Recv(&left, 1, MPI_SRC_T, row_rank - 1, TAG);
+	    left_recv[buf].Wait();
+	    left = left_bufs[buf].data();
 	}
 	if (proc_pos[FIRST_ROW]) {
-	    upper = multiplier_cols.back();
-	    multiplier_cols.pop_back();
+	    upper = multiplier_cols.data() + offset;
 	} else {
-	    col_comm.Recv(&upper, 1, MPI_SRC_T, col_rank - 1, TAG);
+	    upper_recv[buf].Wait();
+	    upper = upper_bufs[buf].data();
 	}
 
 	/* Processors not in last column/row will send operands futher. */
 	if (!proc_pos[LAST_COL]) {
-	    row_comm.Send(&left, 1, MPI_SRC_T, row_rank + 1, TAG);
+	    left_send[buf] = row_comm.Isend(left, count, MPI_SRC_T, row_rank + 1, TAG);
 	}
 	if (!proc_pos[LAST_ROW]) {
-	    col_comm.Send(&upper, 1, MPI_SRC_T, col_rank + 1, TAG);
+	    upper_send[buf] = col_comm.Isend(upper, count, MPI_SRC_T, col_rank + 1, TAG);
+	}
+
+	/* Next chunk in flight during multiplication of this one. */
+	if (i + 1 < chunks) {
+	    post_recv(i + 1);
 	}
 
 	/* Multiplication and accumulation. */
-	acc_res += res = left * static_cast<res_t>(upper);
-	if (!overflow_detected && left != 0 && res / left != upper) {
-	    std::cerr << "WARNING: possible integer overflow detected" << std::endl;
-	    overflow_detected = true;
+	for (int j = 0; j < count; ++j) {
+	    res_t res;
+
+	    acc_res += res = left[j] * static_cast<res_t>(upper[j]);
+	    if (!overflow_detected && left[j] != 0 && res / left[j] != upper[j]) {
+		std::cerr << "WARNING: possible integer overflow detected" << std::endl;
+		overflow_detected = true;
+	    }
 	}
     }
 
+    /* Operands have to stay in memory until they are sent. */
+    MPI::Request::Waitall(2, left_send);
+    MPI::Request::Waitall(2, upper_send);
+
 #ifdef MEASURE_TIME
     MPI::COMM_WORLD.Barrier();
     auto end = std::chrono::high_resolution_clock::now();
@@ -160,7 +251,7 @@ int main(int argc, char *argv[])
        std::cout << diff.count() << std::endl;
     }
 #else
-    Matrix<res_t> product(prod_rows, prod_cols, Matrix<res_t>::PRODUCT);
+    Matrix<res_t> product(col_procs, prod_cols, Matrix<res_t>::PRODUCT);
     product.stretch();
 
     /* Gather data from all processors into root processor. */
@@ -171,6 +262,247 @@ int main(int argc, char *argv[])
 	product.print();
     }
 #endif /* MEASURE_TIME */
+}
+
+/*
+ * Block distributed SUMMA. Processors form grid_rows x grid_cols grid (square
+ * for square count), each of them owns one block of the product and blocks
+ * of both operands with the same rows/columns. The shared dimension is
+ * walked in panels, owner of each multiplicand panel broadcasts it along its
+ * grid row, owner of multiplier panel along its grid column, and everybody
+ * accumulates product of the panels into its block.
+ */
+void summa_multiply(const Matrix<src_t>& multiplicand, const Matrix<src_t>& multiplier,
+	std::size_t prod_rows, std::size_t prod_cols, std::size_t shared_dim, bool binary)
+{
+    const int world_procs = MPI::COMM_WORLD.Get_size();
+    const int world_rank = MPI::COMM_WORLD.Get_rank();
+
+    /* Create grid and its intra row and intra column comunicators. */
+    int dims[2] = { 0, 0 };
+    MPI::Compute_dims(world_procs, 2, dims);
+    const std::size_t grid_rows = dims[0], grid_cols = dims[1];
+    const std::size_t grid_row = world_rank / grid_cols, grid_col = world_rank % grid_cols;
+    auto row_comm = MPI::COMM_WORLD.Split(grid_row, grid_col);
+    auto col_comm = MPI::COMM_WORLD.Split(grid_col, grid_row);
+
+    /*
+     * Product block rows x cols, multiplicand block rows x a_inner (shared
+     * dimension split among grid columns), multiplier block b_inner x cols
+     * (shared dimension split among grid rows).
+     */
+    const std::size_t rows = block_size(prod_rows, grid_rows, grid_row);
+    const std::size_t cols = block_size(prod_cols, grid_cols, grid_col);
+    const std::size_t a_inner = block_size(shared_dim, grid_cols, grid_col);
+    const std::size_t b_inner = block_size(shared_dim, grid_rows, grid_row);
+
+    /* Root packs blocks of both operands in rank order and scatters them. */
+    std::vector<int> a_counts(world_procs), a_displs(world_procs);
+    std::vector<int> b_counts(world_procs), b_displs(world_procs);
+    std::vector<int> c_counts(world_procs), c_displs(world_procs);
+    for (int rank = 0, a_displ = 0, b_displ = 0, c_displ = 0; rank < world_procs; ++rank) {
+	const std::size_t i = rank / grid_cols, j = rank % grid_cols;
+	const std::size_t i_rows = block_size(prod_rows, grid_rows, i);
+	const std::size_t j_cols = block_size(prod_cols, grid_cols, j);
+
+	a_counts[rank] = i_rows * block_size(shared_dim, grid_cols, j);
+	b_counts[rank] = block_size(shared_dim, grid_rows, i) * j_cols;
+	c_counts[rank] = i_rows * j_cols;
+	a_displs[rank] = a_displ;
+	b_displs[rank] = b_displ;
+	c_displs[rank] = c_displ;
+	a_displ += a_counts[rank];
+	b_displ += b_counts[rank];
+	c_displ += c_counts[rank];
+    }
+
+    /* Binary files? Every processor reads its blocks, nothing is scattered. */
+    std::vector<src_t> a_block(rows * a_inner), b_block(b_inner * cols);
+    if (binary) {
+	read_blocks(MPI::COMM_WORLD, MULTIPLICAND_BIN_FILE_NAME,
+		block_offset(prod_rows, grid_rows, grid_row) * shared_dim + block_offset(shared_dim, grid_cols, grid_col),
+		rows, a_inner, shared_dim, a_block.data());
+	read_blocks(MPI::COMM_WORLD, MULTIPLIER_BIN_FILE_NAME,
+		block_offset(shared_dim, grid_rows, grid_row) * prod_cols + block_offset(prod_cols, grid_cols, grid_col),
+		b_inner, cols, prod_cols, b_block.data());
+    }
+
+    std::vector<src_t> a_packed, b_packed;
+    if (world_rank == ROOT_PROC && !binary) {
+	a_packed.reserve(prod_rows * shared_dim);
+	b_packed.reserve(shared_dim * prod_cols);
+	for (std::size_t rank = 0; rank < static_cast<std::size_t>(world_procs); ++rank) {
+	    const std::size_t i = rank / grid_cols, j = rank % grid_cols;
+	    const std::size_t row_off = block_offset(prod_rows, grid_rows, i);
+	    const std::size_t col_off = block_offset(prod_cols, grid_cols, j);
+	    const std::size_t a_off = block_offset(shared_dim, grid_cols, j);
+	    const std::size_t b_off = block_offset(shared_dim, grid_rows, i);
+
+	    for (std::size_t r = 0; r < block_size(prod_rows, grid_rows, i); ++r) {
+		const src_t *row = multiplicand.get_data() + (row_off + r) * shared_dim + a_off;
+
+		a_packed.insert(a_packed.end(), row, row + block_size(shared_dim, grid_cols, j));
+	    }
+	    for (std::size_t r = 0; r < block_size(shared_dim, grid_rows, i); ++r) {
+		const src_t *row = multiplier.get_data() + (b_off + r) * prod_cols + col_off;
+
+		b_packed.insert(b_packed.end(), row, row + block_size(prod_cols, grid_cols, j));
+	    }
+	}
+    }
+
+    if (!binary) {
+	MPI::COMM_WORLD.Scatterv(a_packed.data(), a_counts.data(), a_displs.data(), MPI_SRC_T,
+		a_block.data(), a_block.size(), MPI_SRC_T, ROOT_PROC);
+	MPI::COMM_WORLD.Scatterv(b_packed.data(), b_counts.data(), b_displs.data(), MPI_SRC_T,
+		b_block.data(), b_block.size(), MPI_SRC_T, ROOT_PROC);
+    }
+
+#ifdef MEASURE_TIME
+    MPI::COMM_WORLD.Barrier();
+    auto start = std::chrono::high_resolution_clock::now();
+#endif /* MEASURE_TIME */
+
+    /*
+     * Panel is the widest part of the shared dimension which belongs to one
+     * multiplicand and one multiplier block, there are at most
+     * grid_rows + grid_cols of them.
+     */
+    std::vector<src_t> a_panel(rows * std::max(a_inner, shared_dim / grid_cols + 1));
+    std::vector<src_t> b_panel(std::max(b_inner, shared_dim / grid_rows + 1) * cols);
+    std::vector<res_t> c_block(rows * cols, 0);
+    for (std::size_t k = 0; k < shared_dim; ) {
+	const std::size_t a_owner = block_owner(shared_dim, grid_cols, k);
+	const std::size_t b_owner = block_owner(shared_dim, grid_rows, k);
+	const std::size_t a_off = block_offset(shared_dim, grid_cols, a_owner);
+	const std::size_t b_off = block_offset(shared_dim, grid_rows, b_owner);
+	const std::size_t k_end = std::min(a_off + block_size(shared_dim, grid_cols, a_owner),
+		b_off + block_size(shared_dim, grid_rows, b_owner));
+	const std::size_t width = k_end - k;
+
+	/* Multiplicand panel columns are strided in the block, pack them. */
+	if (grid_col == a_owner) {
+	    for (std::size_t r = 0; r < rows; ++r) {
+		const src_t *row = a_block.data() + r * a_inner + (k - a_off);
+
+		std::copy(row, row + width, a_panel.data() + r * width);
+	    }
+	}
+	row_comm.Bcast(a_panel.data(), rows * width, MPI_SRC_T, a_owner);
+
+	/* Multiplier panel rows are contiguous in the block. */
+	if (grid_row == b_owner) {
+	    const src_t *panel = b_block.data() + (k - b_off) * cols;
+
+	    std::copy(panel, panel + width * cols, b_panel.data());
+	}
+	col_comm.Bcast(b_panel.data(), width * cols, MPI_SRC_T, b_owner);
+
+	multiply_add(rows, cols, width, a_panel.data(), width, b_panel.data(), cols, c_block.data(), cols);
+	k = k_end;
+    }
+
+#ifdef MEASURE_TIME
+    MPI::COMM_WORLD.Barrier();
+    auto end = std::chrono::high_resolution_clock::now();
+    if (world_rank == ROOT_PROC) {
+       std::chrono::duration<double> diff = end - start;
+       std::cout << diff.count() << std::endl;
+    }
+#else
+    /* Gather product blocks into root processor and unpack them. */
+    std::vector<res_t> c_packed(world_rank == ROOT_PROC ? prod_rows * prod_cols : 0);
+    MPI::COMM_WORLD.Gatherv(c_block.data(), c_block.size(), MPI_RES_T,
+	    c_packed.data(), c_counts.data(), c_displs.data(), MPI_RES_T, ROOT_PROC);
+
+    if (world_rank == ROOT_PROC) {
+	Matrix<res_t> product(prod_rows, prod_cols, Matrix<res_t>::PRODUCT);
+	product.stretch();
+
+	for (std::size_t rank = 0; rank < static_cast<std::size_t>(world_procs); ++rank) {
+	    const std::size_t i = rank / grid_cols, j = rank % grid_cols;
+	    const std::size_t i_rows = block_size(prod_rows, grid_rows, i);
+	    const std::size_t j_cols = block_size(prod_cols, grid_cols, j);
+	    const res_t *block = c_packed.data() + c_displs[rank];
+
+	    for (std::size_t r = 0; r < i_rows; ++r) {
+		std::copy(block + r * j_cols, block + (r + 1) * j_cols, product.get_data() +
+			(block_offset(prod_rows, grid_rows, i) + r) * prod_cols + block_offset(prod_cols, grid_cols, j));
+	    }
+	}
+	product.print();
+    }
+#endif /* MEASURE_TIME */
+}
+
+int main(int argc, char *argv[])
+{
+    MPI::Init(argc, argv);
+    const int world_rank = MPI::COMM_WORLD.Get_rank();
+    std::size_t shared_dim, prod_rows, prod_cols;
+    bool block = false; //block distributed SUMMA instead of systolic mesh
+    std::size_t chunk_size = DEFAULT_CHUNK_SIZE;
+    bool binary = false; //binary files read by all processors instead of text ones by root
+
+    /* Parse options. */
+    int opt;
+    while ((opt = getopt(argc, argv, "bc:f")) != -1) {
+	if (opt == 'b') {
+	    block = true;
+	    continue;
+	}
+	if (opt == 'c' && (chunk_size = std::strtoul(optarg, NULL, 10)) > 0) {
+	    continue;
+	}
+	if (opt == 'f') {
+	    binary = true;
+	    continue;
+	}
+	if (world_rank == ROOT_PROC) {
+	    std::cerr << "Usage: " << argv[0] << " [-b] [-c chunk_size] [-f]" << std::endl;
+	}
+	MPI::Finalize();
+	return EXIT_FAILURE;
+    }
+
+    /*
+     * Load both matrices by root processor. Binary files are only checked by
+     * root, processors read their parts of them later.
+     */
+    Matrix<src_t> multiplicand(Matrix<src_t>::MULTIPLICAND);
+    Matrix<src_t> multiplier(Matrix<src_t>::MULTIPLIER);
+    if (world_rank == ROOT_PROC) {
+	try {
+	    if (binary) {
+		multiplicand.load_header(MULTIPLICAND_BIN_FILE_NAME);
+		multiplier.load_header(MULTIPLIER_BIN_FILE_NAME);
+		if (multiplicand.get_cols() != multiplier.get_rows()) {
+		    throw std::domain_error("multiplicand columns and multiplier rows count mismatch");
+		}
+	    } else {
+		multiplicand.load(MULTIPLICAND_FILE_NAME);
+		multiplier.load(MULTIPLIER_FILE_NAME);
+	    }
+	} catch (std::exception& e) {
+	    std::cerr << e.what() << std::endl;
+	    MPI::COMM_WORLD.Abort(EXIT_FAILURE);
+	}
+
+	prod_rows = multiplicand.get_rows();
+	prod_cols = multiplier.get_cols();
+	shared_dim = multiplicand.get_cols();
+    }
+
+    /* Distribute dimensions among all processors. */
+    MPI::COMM_WORLD.Bcast(&prod_rows, 1, MPI::UNSIGNED_LONG, ROOT_PROC);
+    MPI::COMM_WORLD.Bcast(&prod_cols, 1, MPI::UNSIGNED_LONG, ROOT_PROC);
+    MPI::COMM_WORLD.Bcast(&shared_dim, 1, MPI::UNSIGNED_LONG, ROOT_PROC);
+
+    if (block) {
+	summa_multiply(multiplicand, multiplier, prod_rows, prod_cols, shared_dim, binary);
+    } else {
+	systolic_multiply(multiplicand, multiplier, prod_cols, shared_dim, chunk_size, binary);
+    }
 
     MPI::Finalize();
     return EXIT_SUCCESS;
@@ -7,11 +7,49 @@
 #define MM_H
 
 #include <iostream>
+#include <fstream> /* std::ifstream, std::ofstream */
+#include <sstream> /* std::stringstream */
+#include <stdexcept> /* std::invalid_argument, std::domain_error */
 #include <string> /* std::string */
 #include <vector> /* std::vector */
+#include <algorithm> /* std::min */
 #include <cstdlib> /* std::size_of */
 #include <cstring>
 #include <cerrno>
+#include <cstdint> /* std::uint8_t, std::uint16_t, std::uint64_t */
+#include <type_traits> /* std::is_floating_point, std::is_signed, std::is_integral */
+#include <limits> /* std::numeric_limits */
+#include <thread> /* std::thread */
+
+#include <fcntl.h> /* open */
+#include <unistd.h> /* close */
+#include <sys/stat.h> /* fstat */
+#include <sys/mman.h> /* mmap, munmap, posix_madvise */
+
+#define LOAD_MIN_CHUNK_SIZE (1 << 20) //bytes of text parsed by one thread at least
+
+#define MATRIX_MAGIC "PRLM"
+
+/*
+ * Header of binary matrix file. Elements follow right after it in row-major
+ * order and native byte order, header size keeps them aligned, so the
+ * payload may be mapped or read by MPI-IO straight into element buffers.
+ */
+struct MatrixHeader {
+    char magic[4]; //MATRIX_MAGIC without terminating zero
+    char kind; //'i' signed integer, 'u' unsigned integer, 'f' floating point
+    std::uint8_t elem_size; //in bytes
+    std::uint16_t reserved;
+    std::uint64_t rows, cols;
+};
+static_assert(sizeof(MatrixHeader) == 24, "unexpected binary matrix header padding");
+
+/* Kind of element type stored in binary matrix header. */
+template <typename T>
+char matrix_kind(void)
+{
+    return std::is_floating_point<T>::value ? 'f' : (std::is_signed<T>::value ? 'i' : 'u');
+}
 
 template <typename T>
 class Matrix {
@@ -24,6 +62,8 @@ public:
 
     /* Methods. */
     void load(std::string file_name);
+    void load_header(std::string file_name);
+    void save(std::string file_name) const;
     void stretch(void) { data.resize(rows * cols); };
     void print(void) const;
 
@@ -49,48 +89,247 @@ Matrix<T>::Matrix(std::size_t rows, std::size_t cols, Type type): rows(rows),
     data.reserve(rows * cols); //avoid future reallocations
 }
 
+/* Whitespace skipped by operator>> inside of a line. */
+inline bool is_blank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+/*
+ * Parse decimal integer at first, like operator>> (optional sign, digits up
+ * to the first other character). Returns position right after it, or NULL
+ * if there is no number or it doesn't fit into T.
+ */
 template <typename T>
-void Matrix<T>::load(std::string file_name)
+const char *parse_number(const char *first, const char *last, T &value, std::true_type /* integral */)
 {
-    std::size_t read_dim;
+    typedef typename std::make_unsigned<T>::type U;
+    bool negative = false;
 
-    /* Open file and check for errors. */
-    std::ifstream is(file_name);
-    if (!is) {
-        throw std::invalid_argument(file_name + ": " + std::strerror(errno));
+    if (first != last && (*first == '-' || *first == '+')) {
+	negative = (*first++ == '-');
+    }
+    if (first == last || *first < '0' || *first > '9' || (negative && !std::is_signed<T>::value)) {
+	return NULL;
+    }
+
+    const U limit = negative ? static_cast<U>(std::numeric_limits<T>::max()) + 1 :
+	static_cast<U>(std::numeric_limits<T>::max());
+    U acc = 0;
+    for (; first != last && *first >= '0' && *first <= '9'; ++first) {
+	const U digit = *first - '0';
+
+	if (acc > (limit - digit) / 10) {
+	    return NULL;
+	}
+	acc = acc * 10 + digit;
     }
 
-    std::string line;
-    std::getline(is, line);
-    read_dim = std::stoul(line);
+    value = negative ? static_cast<T>(U(0) - acc) : static_cast<T>(acc);
+    return first;
+}
+
+/* Floating point numbers are rare here, let strtold do the work on a copy. */
+template <typename T>
+const char *parse_number(const char *first, const char *last, T &value, std::false_type /* integral */)
+{
+    const char *token_end = first;
+    while (token_end != last && !is_blank(*token_end)) {
+	token_end++;
+    }
+
+    const std::string token(first, token_end);
+    char *parse_end;
+    errno = 0;
+    value = std::strtold(token.c_str(), &parse_end);
+
+    return (parse_end == token.c_str() || errno == ERANGE) ? NULL : first + (parse_end - token.c_str());
+}
+
+/* Read-only mapping of whole text file, empty file isn't mapped. */
+class TextMapping {
+public:
+    /* Constructors. */
+    TextMapping(const std::string& file_name);
+    ~TextMapping() { if (size > 0) munmap(const_cast<char *>(data), size); };
+
+    /* Getters. */
+    const char *get_data() const { return data; };
+    std::size_t const& get_size() const { return size; };
+
+private:
+    TextMapping(const TextMapping&);
+    TextMapping& operator=(const TextMapping&);
+
+    const char *data = NULL;
+    std::size_t size = 0;
+};
+
+inline TextMapping::TextMapping(const std::string& file_name)
+{
+    const int fd = open(file_name.c_str(), O_RDONLY);
+    struct stat file_stat;
+
+    if (fd == -1 || fstat(fd, &file_stat) == -1) {
+	const int saved_errno = errno;
 
-    while (std::getline(is, line)) {
-	std::stringstream line_ss(line);
+	if (fd != -1) {
+	    close(fd);
+	}
+        throw std::invalid_argument(file_name + ": " + std::strerror(saved_errno));
+    }
+
+    if (file_stat.st_size > 0) {
+	void *map = mmap(NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	if (map == MAP_FAILED) {
+	    const int saved_errno = errno;
+
+	    close(fd);
+	    throw std::invalid_argument(file_name + ": " + std::strerror(saved_errno));
+	}
+	data = static_cast<const char *>(map);
+	size = file_stat.st_size;
+	posix_madvise(map, size, POSIX_MADV_SEQUENTIAL);
+    }
+    close(fd);
+}
+
+/*
+ * Rows of one chunk of text file parsed by one thread. Parsing stops at the
+ * first invalid value, its row is the last one in row_cols.
+ */
+template <typename T>
+struct LoadChunk {
+    const char *begin, *end;
+    std::vector<T> data;
+    std::vector<std::size_t> row_cols; //numbers read on each row
+    bool invalid = false;
+
+    void parse(void);
+};
+
+template <typename T>
+void LoadChunk<T>::parse(void)
+{
+    for (const char *line = begin; line < end; ) {
+	const char *line_end = static_cast<const char *>(std::memchr(line, '\n', end - line));
 	std::size_t read_cols = 0;
 
-	rows++;
-	for (T number; line_ss >> number; ) {
+	if (line_end == NULL) {
+	    line_end = end;
+	}
+	for (const char *pos = line; ; ) {
+	    T number;
+
+	    while (pos != line_end && is_blank(*pos)) {
+		pos++;
+	    }
+	    if (pos == line_end) {
+		break;
+	    }
+	    if ((pos = parse_number(pos, line_end, number, typename std::is_integral<T>::type())) == NULL) {
+		row_cols.push_back(read_cols);
+		invalid = true;
+		return;
+	    }
 	    data.push_back(number);
 	    read_cols++;
 	}
-	if (rows == 1) {
-	    cols = read_cols;
-	}
+	row_cols.push_back(read_cols);
+	line = line_end + 1;
+    }
+}
+
+/*
+ * Load text file: number of rows (multiplicand) or columns (multiplier) on
+ * the first line, then one row per line. File is mapped and split into line
+ * aligned chunks parsed by threads, rows are checked in order afterwards, so
+ * the first error found is the same as if it was parsed line by line.
+ */
+template <typename T>
+void Matrix<T>::load(std::string file_name)
+{
+    std::size_t read_dim;
 
-	if (!line_ss.eof() && line_ss.fail()) {
-	    throw std::invalid_argument("Invalid value on row " +
-		    std::to_string(static_cast<unsigned long long>(rows)) + " of "+ file_name);
+    TextMapping file(file_name);
+    const char *text = file.get_data();
+    const char *text_end = text + file.get_size();
+
+    const char *first_end = (text == NULL) ? NULL :
+	static_cast<const char *>(std::memchr(text, '\n', file.get_size()));
+    if (first_end == NULL) {
+	first_end = text_end;
+    }
+    read_dim = std::stoul(std::string(text, first_end));
+
+    /* Split the rest into chunks ending right after newline. */
+    const char *rest = (first_end == text_end) ? text_end : first_end + 1;
+    const std::size_t rest_size = text_end - rest;
+    const std::size_t threads_count = std::max<std::size_t>(1, std::min<std::size_t>(
+		std::thread::hardware_concurrency(), rest_size / LOAD_MIN_CHUNK_SIZE + 1));
+    std::vector<LoadChunk<T>> chunks(threads_count);
+    for (std::size_t i = 0; i < threads_count; ++i) {
+	const char *chunk_end = rest + rest_size * (i + 1) / threads_count;
+
+	chunks[i].begin = (i == 0) ? rest : chunks[i - 1].end;
+	if (i + 1 == threads_count) {
+	    chunk_end = text_end;
+	} else if (chunk_end > chunks[i].begin) {
+	    const char *newline = static_cast<const char *>(std::memchr(chunk_end - 1, '\n', text_end - chunk_end + 1));
+	    chunk_end = (newline == NULL) ? text_end : newline + 1;
+	} else {
+	    chunk_end = chunks[i].begin;
 	}
-	if (read_cols == 0 || read_cols != cols) {
-	    throw std::invalid_argument("Invalid column count on row " +
-		    std::to_string(static_cast<unsigned long long>(rows)) + " of "+ file_name);
+	chunks[i].end = chunk_end;
+    }
+
+    /* The calling thread parses the first chunk. */
+    std::vector<std::thread> threads;
+    for (std::size_t i = 1; i < threads_count; ++i) {
+	threads.emplace_back(&LoadChunk<T>::parse, &chunks[i]);
+    }
+    chunks[0].parse();
+    for (std::size_t i = 0; i < threads.size(); ++i) {
+	threads[i].join();
+    }
+
+    /* Only chunk? Take its numbers as they are, otherwise join them. */
+    if (threads_count == 1) {
+	data.swap(chunks[0].data);
+    } else {
+	std::size_t total_size = 0;
+
+	for (std::size_t i = 0; i < threads_count; ++i) {
+	    total_size += chunks[i].data.size();
 	}
+	data.reserve(total_size);
     }
 
-    if (!is.eof()) {
-        throw std::invalid_argument(file_name + ": " + std::strerror(errno));
+    for (std::size_t i = 0; i < threads_count; ++i) {
+	const LoadChunk<T>& chunk = chunks[i];
+
+	for (std::size_t j = 0; j < chunk.row_cols.size(); ++j) {
+	    const std::size_t read_cols = chunk.row_cols[j];
+
+	    rows++;
+	    if (rows == 1) {
+		cols = read_cols;
+	    }
+
+	    if (chunk.invalid && j + 1 == chunk.row_cols.size()) {
+		throw std::invalid_argument("Invalid value on row " +
+			std::to_string(static_cast<unsigned long long>(rows)) + " of "+ file_name);
+	    }
+	    if (read_cols == 0 || read_cols != cols) {
+		throw std::invalid_argument("Invalid column count on row " +
+			std::to_string(static_cast<unsigned long long>(rows)) + " of "+ file_name);
+	    }
+	}
+	if (threads_count > 1) {
+	    data.insert(data.end(), chunk.data.begin(), chunk.data.end());
+	}
     }
-    is.close();
 
     switch (type) {
 	case MULTIPLICAND:
@@ -109,6 +348,153 @@ void Matrix<T>::load(std::string file_name)
     }
 }
 
+/*
+ * Register block of the product computed by one micro-kernel call is GEMM_MR
+ * rows of one SIMD register (GEMM_ROW_BYTES) each, so it has gemm_nr<R>()
+ * columns. Cache blocks of operands: packed GEMM_KC x nr multiplier panel
+ * fits L1, GEMM_MC x GEMM_KC multiplicand block L2 and GEMM_KC x GEMM_NC
+ * multiplier panel L3.
+ */
+#if defined(__AVX512F__)
+#define GEMM_ROW_BYTES 64
+#define GEMM_MR 8
+#elif defined(__AVX__)
+#define GEMM_ROW_BYTES 32
+#define GEMM_MR 6
+#else
+#define GEMM_ROW_BYTES 16
+#define GEMM_MR 4
+#endif
+#define GEMM_KC 256
+#define GEMM_MC 96
+#define GEMM_NC 2048
+
+template <typename R>
+constexpr std::size_t gemm_nr(void)
+{
+    return GEMM_ROW_BYTES / sizeof(R);
+}
+
+/*
+ * Packs mc x kc block of a into micro-panels of GEMM_MR rows stored column
+ * after column, rows past the end are zero.
+ */
+template <typename S>
+void gemm_pack_a(std::size_t mc, std::size_t kc, const S *a, std::size_t lda, S *packed)
+{
+    for (std::size_t i = 0; i < mc; i += GEMM_MR) {
+	for (std::size_t k = 0; k < kc; ++k) {
+	    for (std::size_t ii = 0; ii < GEMM_MR; ++ii) {
+		*packed++ = (i + ii < mc) ? a[(i + ii) * lda + k] : S();
+	    }
+	}
+    }
+}
+
+/*
+ * Packs kc x nc panel of b into micro-panels of nr columns stored row after
+ * row (the panel is transposed to the order the kernel reads it), columns
+ * past the end are zero.
+ */
+template <std::size_t nr, typename S>
+void gemm_pack_b(std::size_t kc, std::size_t nc, const S *b, std::size_t ldb, S *packed)
+{
+    for (std::size_t j = 0; j < nc; j += nr) {
+	for (std::size_t k = 0; k < kc; ++k) {
+	    for (std::size_t jj = 0; jj < nr; ++jj) {
+		*packed++ = (j + jj < nc) ? b[k * ldb + j + jj] : S();
+	    }
+	}
+    }
+}
+
+/*
+ * Adds product of packed micro-panels to mr x nr (at most GEMM_MR x
+ * gemm_nr<R>()) block of c. Every row of the register block is one vector
+ * (GCC vector extension, as wide as the SIMD enabled e.g. by -march=native),
+ * so the inner loop is GEMM_MR vector multiply-adds of broadcast multiplicand
+ * number and one multiplier row widened to R.
+ */
+template <typename S, typename R>
+void gemm_kernel(std::size_t kc, const S *a, const S *b, R *c, std::size_t ldc, std::size_t mr, std::size_t nr)
+{
+    constexpr std::size_t NR = gemm_nr<R>();
+#ifdef __GNUC__
+    typedef S src_row_t __attribute__((vector_size(NR * sizeof(S))));
+    typedef R row_t __attribute__((vector_size(NR * sizeof(R))));
+    row_t acc[GEMM_MR] = { };
+
+    for (std::size_t k = 0; k < kc; ++k) {
+	src_row_t src_row;
+	std::memcpy(&src_row, b + k * NR, sizeof(src_row));
+	const row_t row = __builtin_convertvector(src_row, row_t);
+
+	for (std::size_t i = 0; i < GEMM_MR; ++i) {
+	    acc[i] += static_cast<R>(a[k * GEMM_MR + i]) * row;
+	}
+    }
+#else
+    R acc[GEMM_MR][NR] = { };
+
+    for (std::size_t k = 0; k < kc; ++k) {
+	for (std::size_t i = 0; i < GEMM_MR; ++i) {
+	    for (std::size_t j = 0; j < NR; ++j) {
+		acc[i][j] += static_cast<R>(a[k * GEMM_MR + i]) * static_cast<R>(b[k * NR + j]);
+	    }
+	}
+    }
+#endif
+
+    for (std::size_t i = 0; i < mr; ++i) {
+	for (std::size_t j = 0; j < nr; ++j) {
+	    c[i * ldc + j] += acc[i][j];
+	}
+    }
+}
+
+/*
+ * Adds product of rows x inner block a and inner x cols block b to rows x cols
+ * block c. Blocks may be parts of bigger matrices, leading dimensions are
+ * lengths of their rows. Operand and result types may differ.
+ *
+ * Cache blocked GEMM: for every GEMM_KC x GEMM_NC panel of b (packed once)
+ * and every GEMM_MC x GEMM_KC block of a (packed once), micro-kernel walks
+ * the packed operands contiguously and computes register blocks of c.
+ */
+template <typename S, typename R>
+void multiply_add(std::size_t rows, std::size_t cols, std::size_t inner,
+	const S *a, std::size_t lda, const S *b, std::size_t ldb, R *c, std::size_t ldc)
+{
+    constexpr std::size_t NR = gemm_nr<R>();
+    const std::size_t kc_max = std::min<std::size_t>(GEMM_KC, inner);
+    const std::size_t mc_max = std::min<std::size_t>(GEMM_MC, rows);
+    const std::size_t nc_max = std::min<std::size_t>(GEMM_NC, cols);
+    std::vector<S> packed_a(kc_max * ((mc_max + GEMM_MR - 1) / GEMM_MR * GEMM_MR));
+    std::vector<S> packed_b(kc_max * ((nc_max + NR - 1) / NR * NR));
+
+    for (std::size_t jc = 0; jc < cols; jc += GEMM_NC) {
+	const std::size_t nc = std::min<std::size_t>(GEMM_NC, cols - jc);
+
+	for (std::size_t pc = 0; pc < inner; pc += GEMM_KC) {
+	    const std::size_t kc = std::min<std::size_t>(GEMM_KC, inner - pc);
+
+	    gemm_pack_b<NR>(kc, nc, b + pc * ldb + jc, ldb, packed_b.data());
+	    for (std::size_t ic = 0; ic < rows; ic += GEMM_MC) {
+		const std::size_t mc = std::min<std::size_t>(GEMM_MC, rows - ic);
+
+		gemm_pack_a(mc, kc, a + ic * lda + pc, lda, packed_a.data());
+		for (std::size_t jr = 0; jr < nc; jr += NR) {
+		    for (std::size_t ir = 0; ir < mc; ir += GEMM_MR) {
+			gemm_kernel(kc, packed_a.data() + ir * kc, packed_b.data() + jr * kc,
+				c + (ic + ir) * ldc + jc + jr, ldc,
+				std::min<std::size_t>(GEMM_MR, mc - ir), std::min<std::size_t>(NR, nc - jr));
+		    }
+		}
+	    }
+	}
+    }
+}
+
 template <typename T>
 Matrix<T> Matrix<T>::operator*(const Matrix &rhs) const
 {
@@ -119,18 +505,60 @@ Matrix<T> Matrix<T>::operator*(const Matrix &rhs) const
 	return res;
     }
 
-    for (std::size_t i = 0; i < rows; ++i) {
-	for (std::size_t j = 0; j < rhs.cols; ++j) {
-	    T product = 0;
+    res.stretch(); //zeroed, kernel only adds
+    multiply_add(rows, rhs.cols, cols, data.data(), cols, rhs.data.data(), rhs.cols, res.data.data(), rhs.cols);
 
-	    for (std::size_t k = 0; k < cols; ++k) {
-		product += data[i * cols + k] * rhs.data[k * rhs.cols + j];
-	    }
-	    res.data.push_back(product);
-	}
+    return res;
+}
+
+/*
+ * Read and check only header of binary matrix file, elements are left to
+ * be read by whoever needs them.
+ */
+template <typename T>
+void Matrix<T>::load_header(std::string file_name)
+{
+    MatrixHeader header;
+
+    std::ifstream is(file_name, std::ios::binary);
+    if (!is) {
+        throw std::invalid_argument(file_name + ": " + std::strerror(errno));
     }
 
-    return res;
+    if (!is.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+	    std::memcmp(header.magic, MATRIX_MAGIC, sizeof(header.magic)) != 0) {
+	throw std::invalid_argument(file_name + ": not a binary matrix file");
+    }
+    if (header.kind != matrix_kind<T>() || header.elem_size != sizeof(T)) {
+	throw std::domain_error(file_name + ": unexpected element type");
+    }
+    if (header.rows == 0 || header.cols == 0) {
+	throw std::domain_error(file_name + ": empty matrix");
+    }
+
+    /* Truncated file would be read short by every processor. */
+    is.seekg(0, std::ios::end);
+    if (static_cast<std::uint64_t>(is.tellg()) != sizeof(header) + header.rows * header.cols * sizeof(T)) {
+	throw std::domain_error(file_name + ": specified and real elements count mismatch");
+    }
+
+    rows = header.rows;
+    cols = header.cols;
+}
+
+template <typename T>
+void Matrix<T>::save(std::string file_name) const
+{
+    MatrixHeader header = { { 0 }, matrix_kind<T>(), sizeof(T), 0, rows, cols };
+    std::memcpy(header.magic, MATRIX_MAGIC, sizeof(header.magic));
+
+    std::ofstream os(file_name, std::ios::binary | std::ios::trunc);
+    os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    os.write(reinterpret_cast<const char *>(data.data()), data.size() * sizeof(T));
+    os.close();
+    if (!os) {
+        throw std::invalid_argument(file_name + ": " + std::strerror(errno));
+    }
 }
 
 template <typename T>
@@ -3,8 +3,16 @@
 mat1=$(head -n1 mat1)
 mat2=$(head -n1 mat2)
  
-cpus=$((mat1*mat2))
+#one processor per product element, or given number of processors owning
+#blocks of the product (block SUMMA)
+if [ $# -lt 1 ]; then
+    cpus=$((mat1*mat2))
+    mode=""
+else
+    cpus=$1
+    mode="-b"
+fi
  
-mpic++ --prefix /usr/local/share/OpenMPI -o mm mm.cpp -std=c++0x
-mpirun --prefix /usr/local/share/OpenMPI -np $cpus mm
+mpic++ --prefix /usr/local/share/OpenMPI -O3 -march=native -pthread -o mm mm.cpp -std=c++0x
+mpirun --prefix /usr/local/share/OpenMPI -np $cpus mm $mode
 rm -f mm
@@ -9,6 +9,8 @@ int_range = 2**31
 
 cores = int(sys.argv[1])
 sq_cores = int(math.sqrt(float(sys.argv[1])))
+#optional number of processors for block SUMMA, matrix sizes are then independent of it
+block_procs = sys.argv[2] if len(sys.argv) > 2 else None
 
 modes = [
     {'max_n': 1, 'max_m': 1, 'max_p': 1, 'runs': 10}, #1x1 * 1x1
@@ -17,6 +19,8 @@ modes = [
     {'max_n': sq_cores, 'max_m': 1, 'max_p': sq_cores, 'runs': 10}, #row vector * column vector
     {'max_n': sq_cores, 'max_m': 100000, 'max_p': sq_cores, 'runs': 10} #NxM * MxP
 ]
+if block_procs:
+    modes.append({'max_n': 200, 'max_m': 200, 'max_p': 200, 'runs': 10}) #bigger than processor count
 
 for mode in modes:
     print mode
@@ -40,7 +44,7 @@ for mode in modes:
             np.savetxt(f, mat2, fmt='%i')
 
         #call test.sh
-        proc = subprocess.Popen(['./test.sh'], stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+        proc = subprocess.Popen(['./test.sh'] + ([block_procs] if block_procs else []), stdout=subprocess.PIPE, stderr=subprocess.PIPE)
         stdout, stderr = proc.communicate()
         if proc.returncode or stderr:
             print stderr
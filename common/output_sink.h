@@ -0,0 +1,165 @@
+/*
+ * Buffered output shared by the sorting programs (1proj odd-even, 2proj pms).
+ *
+ * Everything goes through one large buffer that is written by write(2) only
+ * when full, on flush() and in destructor, so nothing is flushed per line.
+ * Integers are formatted by hand, iostreams aren't involved at all.
+ *
+ * Modes:
+ *  - TEXT: formatted output (operator<<), usually to stdout,
+ *  - BINARY: only raw bytes passed to write_raw(), text is dropped, so the
+ *    same code prints text or dumps sorted numbers in the input file format,
+ *  - DISCARD: nothing is written (measurements without output).
+ */
+
+#ifndef OUTPUT_SINK_H
+#define OUTPUT_SINK_H
+
+#include <string> /* std::string */
+#include <algorithm> /* std::min */
+#include <vector> /* std::vector */
+#include <stdexcept> /* std::runtime_error */
+#include <cstring> /* std::strlen, std::strerror, std::memcpy */
+#include <cerrno>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#define OUTPUT_SINK_BUFFER_SIZE (1 << 16)
+
+class OutputSink {
+public:
+    enum Mode { TEXT, BINARY, DISCARD };
+
+    /* Constructors, empty file name means stdout. */
+    OutputSink(Mode mode = TEXT, const std::string &file_name = "");
+    ~OutputSink();
+
+    /* Methods. */
+    void write_raw(const void *data, std::size_t size);
+    void flush(void);
+
+    /* Text operators, ignored in other than TEXT mode. */
+    OutputSink& operator<<(const char *str) { return text(str, std::strlen(str)); };
+    OutputSink& operator<<(const std::string &str) { return text(str.data(), str.size()); };
+    OutputSink& operator<<(char c) { return text(&c, 1); };
+    OutputSink& operator<<(unsigned long long number);
+    OutputSink& operator<<(long long number);
+    OutputSink& operator<<(unsigned long number) { return *this << static_cast<unsigned long long>(number); };
+    OutputSink& operator<<(long number) { return *this << static_cast<long long>(number); };
+    OutputSink& operator<<(unsigned number) { return *this << static_cast<unsigned long long>(number); };
+    OutputSink& operator<<(int number) { return *this << static_cast<long long>(number); };
+
+    /* Getters. */
+    Mode const& get_mode() const { return mode; };
+
+private:
+    OutputSink(const OutputSink&); //not copyable, owns file descriptor
+    OutputSink& operator=(const OutputSink&);
+
+    OutputSink& text(const char *str, std::size_t size);
+    void append(const void *data, std::size_t size);
+
+    const Mode mode;
+    int fd = STDOUT_FILENO;
+    std::vector<char> buffer;
+    std::size_t used = 0;
+};
+
+inline OutputSink::OutputSink(Mode mode, const std::string &file_name): mode(mode)
+{
+    if (mode != DISCARD && !file_name.empty()) {
+	fd = open(file_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+	    throw std::runtime_error(file_name + ": " + std::strerror(errno));
+	}
+    }
+    buffer.resize(OUTPUT_SINK_BUFFER_SIZE);
+}
+
+inline OutputSink::~OutputSink()
+{
+    try {
+	flush();
+    } catch (const std::runtime_error&) {
+	; //destructor mustn't throw, call flush() explicitly to get errors
+    }
+    if (fd != STDOUT_FILENO) {
+	close(fd);
+    }
+}
+
+inline void OutputSink::flush(void)
+{
+    std::size_t written = 0;
+
+    while (written < used) {
+	const ssize_t ret = ::write(fd, buffer.data() + written, used - written);
+
+	if (ret < 0) {
+	    if (errno == EINTR) {
+		continue;
+	    }
+	    used = 0;
+	    throw std::runtime_error(std::string("write(): ") + std::strerror(errno));
+	}
+	written += ret;
+    }
+    used = 0;
+}
+
+inline void OutputSink::append(const void *data, std::size_t size)
+{
+    const char *bytes = static_cast<const char *>(data);
+
+    while (size > 0) {
+	if (used == buffer.size()) {
+	    flush();
+	}
+
+	const std::size_t to_copy = std::min(size, buffer.size() - used);
+	std::memcpy(buffer.data() + used, bytes, to_copy);
+	used += to_copy;
+	bytes += to_copy;
+	size -= to_copy;
+    }
+}
+
+inline void OutputSink::write_raw(const void *data, std::size_t size)
+{
+    if (mode == BINARY) {
+	append(data, size);
+    }
+}
+
+inline OutputSink& OutputSink::text(const char *str, std::size_t size)
+{
+    if (mode == TEXT) {
+	append(str, size);
+    }
+    return *this;
+}
+
+inline OutputSink& OutputSink::operator<<(unsigned long long number)
+{
+    char digits[20]; //2^64 has 20 decimal digits
+    char *first = digits + sizeof(digits);
+
+    do {
+	*--first = '0' + number % 10;
+	number /= 10;
+    } while (number > 0);
+
+    return text(first, digits + sizeof(digits) - first);
+}
+
+inline OutputSink& OutputSink::operator<<(long long number)
+{
+    if (number < 0) {
+	*this << '-';
+	return *this << (0ULL - static_cast<unsigned long long>(number));
+    }
+    return *this << static_cast<unsigned long long>(number);
+}
+
+#endif //OUTPUT_SINK_H